@@ -7,9 +7,16 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Transfers are queued per channel as struct disk_request and
+   carried out by one I/O thread per channel.  The thread serves
+   the queue in C-LOOK order (ascending sector numbers, then back
+   to the lowest) and merges requests for adjacent sectors of the
+   same disk and direction into a single command. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -32,6 +39,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +55,14 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+
+/* Largest number of sectors we ask for in one READ/WRITE MULTIPLE
+   DRQ block, and in one command. */
+#define MULTIPLE_MAX 16
+#define COMMAND_SECTORS_MAX DISK_REQUEST_SECTORS_MAX
 
 /* An ATA device. */
 struct disk {
@@ -56,6 +72,8 @@ struct disk {
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
 	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	int multiple;               /* Sectors per DRQ block of READ/WRITE
+								   MULTIPLE, 0 if not supported. */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
@@ -73,6 +91,13 @@ struct channel {
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+	struct list queue;          /* Pending disk_requests, sorted by
+								   queue_key(). */
+	struct lock queue_lock;     /* Protects QUEUE. */
+	struct semaphore queue_sema;        /* Up'd once per submitted request. */
+	uint64_t head;              /* queue_key() just past the last
+								   transfer, for C-LOOK. */
+
 	struct disk devices[2];     /* The devices on this channel. */
 };
 
@@ -84,10 +109,11 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
+static void set_multiple_mode (struct disk *, int multiple);
 
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
@@ -96,6 +122,13 @@ static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
 
+static uint64_t queue_key (const struct disk *, disk_sector_t);
+static bool request_less (const struct list_elem *,
+		const struct list_elem *, void *aux);
+static void take_batch (struct channel *, struct list *batch);
+static void transfer_batch (struct channel *, struct list *batch);
+static void channel_io_daemon (void *channel_);
+
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
@@ -122,6 +155,10 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		list_init (&c->queue);
+		lock_init (&c->queue_lock);
+		sema_init (&c->queue_sema, 0);
+		c->head = 0;
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -150,6 +187,10 @@ disk_init (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++)
 			if (c->devices[dev_no].is_ata)
 				identify_ata_device (&c->devices[dev_no]);
+
+		/* Start serving the request queue. */
+		if (c->devices[0].is_ata || c->devices[1].is_ata)
+			thread_create (c->name, PRI_MAX, channel_io_daemon, c);
 	}
 
 	/* DO NOT MODIFY BELOW LINES. */
@@ -209,21 +250,7 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
-
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_read_multi (d, sec_no, buffer, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -233,23 +260,253 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    per-disk locking is unneeded. */
 void 
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
-	struct channel *c;
+	disk_write_multi (d, sec_no, buffer, 1);
+}
+
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  Each command moves up to COMMAND_SECTORS_MAX sectors,
+   and with READ MULTIPLE the disk interrupts once per
+   D->multiple sectors instead of once per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multi (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t cnt) {
+	uint8_t *p = buffer;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY); // 이 함수 내에서 버퍼 내용을 디스크에 write함.
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
-	lock_release (&c->lock);
+	while (cnt > 0) {
+		struct disk_request req;
+		size_t n = cnt < COMMAND_SECTORS_MAX ? cnt : COMMAND_SECTORS_MAX;
+
+		disk_request_init (&req, d, sec_no, p, n, false);
+		disk_submit (&req);
+		disk_wait (&req);
+		sec_no += n;
+		p += n * DISK_SECTOR_SIZE;
+		cnt -= n;
+	}
+}
+
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes,
+   as disk_read_multi() does for reads.  Returns after the disk
+   has acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write_multi (struct disk *d, disk_sector_t sec_no, const void *buffer,
+		size_t cnt) {
+	const uint8_t *p = buffer;
+
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+
+	while (cnt > 0) {
+		struct disk_request req;
+		size_t n = cnt < COMMAND_SECTORS_MAX ? cnt : COMMAND_SECTORS_MAX;
+
+		disk_request_init (&req, d, sec_no, (void *) p, n, true);
+		disk_submit (&req);
+		disk_wait (&req);
+		sec_no += n;
+		p += n * DISK_SECTOR_SIZE;
+		cnt -= n;
+	}
+}
+
+/* Initializes REQ to transfer CNT sectors starting at SEC_NO
+   between disk D and BUFFER, writing to the disk if WRITE. */
+void
+disk_request_init (struct disk_request *req, struct disk *d,
+		disk_sector_t sec_no, void *buffer, size_t cnt, bool write) {
+	ASSERT (req != NULL);
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+	ASSERT (cnt > 0 && cnt <= DISK_REQUEST_SECTORS_MAX);
+	ASSERT (sec_no + cnt <= d->capacity);
+
+	req->disk = d;
+	req->sec_no = sec_no;
+	req->cnt = cnt;
+	req->buffer = buffer;
+	req->write = write;
+	sema_init (&req->done, 0);
+}
+
+/* Queues REQ on its disk's channel and returns without waiting
+   for the transfer. */
+void
+disk_submit (struct disk_request *req) {
+	struct channel *c = req->disk->channel;
+
+	lock_acquire (&c->queue_lock);
+	list_insert_ordered (&c->queue, &req->elem, request_less, NULL);
+	lock_release (&c->queue_lock);
+	sema_up (&c->queue_sema);
+}
+
+/* Waits until REQ, which must have been submitted, is complete. */
+void
+disk_wait (struct disk_request *req) {
+	sema_down (&req->done);
 }
 
+/* Request queue. */
+
+/* Returns the position of sector SEC_NO of disk D in the order the
+   elevator sweeps the channel: master before slave, then by
+   sector. */
+static uint64_t
+queue_key (const struct disk *d, disk_sector_t sec_no) {
+	return ((uint64_t) d->dev_no << 32) | sec_no;
+}
+
+/* Orders requests by queue_key().  Requests with equal keys keep
+   their submission order. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct disk_request *a = list_entry (a_, struct disk_request, elem);
+	const struct disk_request *b = list_entry (b_, struct disk_request, elem);
+
+	return queue_key (a->disk, a->sec_no) < queue_key (b->disk, b->sec_no);
+}
+
+/* Moves the next requests to serve from channel C's queue to
+   BATCH.  C-LOOK: the first request at or past C->head, or the
+   lowest one if the sweep has reached the end.  Queued requests
+   that continue it (same disk and direction, next sector) join it,
+   up to COMMAND_SECTORS_MAX sectors in all.  BATCH is left empty
+   if the queue is.  queue_lock must be held. */
+static void
+take_batch (struct channel *c, struct list *batch) {
+	struct disk_request *req = NULL;
+	struct list_elem *e;
+	size_t cnt;
+
+	ASSERT (lock_held_by_current_thread (&c->queue_lock));
+
+	if (list_empty (&c->queue))
+		return;
+	for (e = list_begin (&c->queue); e != list_end (&c->queue);
+			e = list_next (e)) {
+		req = list_entry (e, struct disk_request, elem);
+		if (queue_key (req->disk, req->sec_no) >= c->head)
+			break;
+	}
+	if (e == list_end (&c->queue))
+		e = list_begin (&c->queue);
+
+	/* E 뒤쪽은 key 순서라서 이어지는 요청은 바로 뒤에서만 찾으면 됨 */
+	req = list_entry (e, struct disk_request, elem);
+	cnt = 0;
+	while (e != list_end (&c->queue)) {
+		struct disk_request *next = list_entry (e, struct disk_request, elem);
+
+		if (next != req
+				&& (next->disk != req->disk || next->write != req->write
+					|| next->sec_no != req->sec_no + cnt
+					|| cnt + next->cnt > COMMAND_SECTORS_MAX))
+			break;
+		cnt += next->cnt;
+		e = list_remove (e);
+		list_push_back (batch, &next->elem);
+	}
+	c->head = queue_key (req->disk, req->sec_no + cnt);
+}
+
+/* Carries out the requests in BATCH, which take_batch() chose, as
+   one command.  C's lock must be held. */
+static void
+transfer_batch (struct channel *c, struct list *batch) {
+	struct disk_request *first = list_entry (list_front (batch),
+			struct disk_request, elem);
+	struct disk *d = first->disk;
+	bool write = first->write;
+	size_t block = d->multiple > 0 ? (size_t) d->multiple : 1;
+	struct list_elem *e;
+	size_t cnt = 0, ofs, i, j;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+
+	for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+		cnt += list_entry (e, struct disk_request, elem)->cnt;
+
+	select_sector (d, first->sec_no, cnt);
+	if (write)
+		issue_pio_command (c, d->multiple > 0 ? CMD_WRITE_MULTIPLE
+				: CMD_WRITE_SECTOR_RETRY); // 이 함수 내에서 버퍼 내용을 디스크에 write함.
+	else
+		issue_pio_command (c, d->multiple > 0 ? CMD_READ_MULTIPLE
+				: CMD_READ_SECTOR_RETRY);
+
+	/* 한 DRQ block 이 여러 요청의 buffer 에 걸칠 수 있으므로 sector 단위로 옮김 */
+	e = list_begin (batch);
+	ofs = 0;
+	for (i = 0; i < cnt; i += block) {
+		size_t k = cnt - i < block ? cnt - i : block;
+
+		if (!write)
+			sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk %s failed, sector=%"PRDSNu, d->name,
+					write ? "write" : "read", (disk_sector_t) (first->sec_no + i));
+		for (j = 0; j < k; j++) {
+			struct disk_request *req = list_entry (e, struct disk_request, elem);
+			uint8_t *p = (uint8_t *) req->buffer + ofs * DISK_SECTOR_SIZE;
+
+			if (write)
+				output_sectors (c, p, 1);
+			else
+				input_sectors (c, p, 1);
+			if (++ofs == req->cnt) {
+				e = list_next (e);
+				ofs = 0;
+			}
+		}
+		if (write)
+			sema_down (&c->completion_wait);
+	}
+
+	if (write)
+		d->write_cnt += cnt;
+	else
+		d->read_cnt += cnt;
+}
+
+/* Serves the request queue of the channel passed as CHANNEL_. */
+static void
+channel_io_daemon (void *channel_) {
+	struct channel *c = channel_;
+
+	for (;;) {
+		struct list batch;
+
+		/* 합쳐서 처리된 요청 몫의 up 은 빈 batch 로 지나감 */
+		sema_down (&c->queue_sema);
+		list_init (&batch);
+		lock_acquire (&c->queue_lock);
+		take_batch (c, &batch);
+		lock_release (&c->queue_lock);
+		if (list_empty (&batch))
+			continue;
+
+		lock_acquire (&c->lock);
+		transfer_batch (c, &batch);
+		lock_release (&c->lock);
+
+		while (!list_empty (&batch)) {
+			struct disk_request *req = list_entry (list_pop_front (&batch),
+					struct disk_request, elem);
+			sema_up (&req->done);
+		}
+	}
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -359,11 +616,16 @@ identify_ata_device (struct disk *d) {
 		d->is_ata = false;
 		return;
 	}
-	input_sector (c, id);
+	input_sectors (c, id, 1);
 
 	/* Calculate capacity. */
 	d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+	/* Word 47 gives the most sectors per READ/WRITE MULTIPLE
+	   block, 0 if those commands are not supported. */
+	set_multiple_mode (d, (id[47] & 0xff) < MULTIPLE_MAX
+			? id[47] & 0xff : MULTIPLE_MAX);
+
 	/* Print identification message. */
 	printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
 	if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -401,18 +663,40 @@ print_ata_string (char *string, size_t size) {
 		printf ("%c", string[i ^ 1]);
 }
 
+/* Sends SET MULTIPLE MODE to disk D so that READ/WRITE MULTIPLE
+   move MULTIPLE sectors per interrupt, and records the result in
+   D->multiple.  If MULTIPLE is 0 or the disk rejects the command,
+   D->multiple is 0 and only single-sector commands are used. */
+static void
+set_multiple_mode (struct disk *d, int multiple) {
+	struct channel *c = d->channel;
+
+	d->multiple = 0;
+	if (multiple <= 0)
+		return;
+
+	select_device_wait (d);
+	outb (reg_nsect (c), multiple);
+	issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+	sema_down (&c->completion_wait);
+	wait_while_busy (d);
+	if (!(inb (reg_alt_status (c)) & STA_ERR))
+		d->multiple = multiple;
+}
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the count CNT of sectors to transfer to the
+   disk's sector selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
+	ASSERT (cnt > 0 && cnt <= COMMAND_SECTORS_MAX);
+	ASSERT (sec_no + cnt <= d->capacity);
 	ASSERT (sec_no < (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -432,18 +716,19 @@ issue_pio_command (struct channel *c, uint8_t command) {
 	outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for DISK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) {
-	insw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
+input_sectors (struct channel *c, void *sectors, size_t cnt) {
+	insw (reg_data (c), sectors, cnt * DISK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain DISK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * DISK_SECTOR_SIZE bytes. */
 static void
-output_sector (struct channel *c, const void *sector) {
-	outsw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
+output_sectors (struct channel *c, const void *sectors, size_t cnt) {
+	outsw (reg_data (c), sectors, cnt * DISK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -0,0 +1,357 @@
+/* buffer_cache.c: Sector buffer cache for the file system disk. */
+
+#include "filesys/buffer_cache.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A cached sector.
+ *
+ * bc_lock protects which sector each entry holds (SECTOR, VALID)
+ * and the clock hand.  An entry's own LOCK is held while its data
+ * is being loaded, copied, or written back, so disk I/O on one
+ * entry does not block lookups of the others.  SECTOR and VALID
+ * change only with both locks held. */
+struct bc_entry {
+	disk_sector_t sector;           /* Sector held, if VALID. */
+	bool valid;                     /* Holds SECTOR. */
+	bool dirty;                     /* Modified since last written back. */
+	bool accessed;                  /* Used since the clock hand last passed. */
+	struct lock lock;               /* Held while using DATA. */
+	uint8_t data[DISK_SECTOR_SIZE]; /* Sector contents. */
+};
+
+static struct bc_entry cache[BUFFER_CACHE_SIZE];
+static struct lock bc_lock;
+static size_t clock_hand;
+
+/* buffer_cache_flush_all() 이 한꺼번에 디스크 큐에 넣는 쓰기 요청.
+   flush daemon 과 종료 시의 flush 가 겹칠 수 있어 flush_lock 으로 보호 */
+static struct disk_request flush_reqs[BUFFER_CACHE_SIZE];
+static struct lock flush_lock;
+
+/* 비동기 read-ahead 요청 큐.  가득 차면 요청을 버린다.
+   daemon 은 한 번에 RA_BATCH 개까지 디스크 큐에 넣고 함께 기다림 */
+#define RA_QUEUE_SIZE 16
+#define RA_BATCH 8
+static disk_sector_t ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head;
+static size_t ra_cnt;
+static struct lock ra_lock;
+static struct semaphore ra_sema;
+
+static struct bc_entry *bc_lookup (disk_sector_t);
+static struct bc_entry *bc_evict (void);
+static struct bc_entry *bc_get (disk_sector_t, bool load);
+static struct bc_entry *bc_get_new (disk_sector_t);
+static void bc_flush_daemon (void *aux);
+static void bc_readahead_daemon (void *aux);
+
+/* Initializes the buffer cache and starts its flush and
+ * read-ahead threads.  filesys_disk must already be set. */
+void
+buffer_cache_init (void) {
+	size_t i;
+
+	lock_init (&bc_lock);
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		cache[i].valid = false;
+		lock_init (&cache[i].lock);
+	}
+	clock_hand = 0;
+	lock_init (&flush_lock);
+
+	lock_init (&ra_lock);
+	sema_init (&ra_sema, 0);
+	ra_head = ra_cnt = 0;
+
+	thread_create ("bc_flush", PRI_DEFAULT, bc_flush_daemon, NULL);
+	thread_create ("bc_readahead", PRI_DEFAULT, bc_readahead_daemon, NULL);
+}
+
+/* Writes every dirty entry back to disk.  Called at shutdown. */
+void
+buffer_cache_done (void) {
+	buffer_cache_flush_all ();
+}
+
+/* Copies SIZE bytes at SECTOR_OFS within SECTOR into BUFFER. */
+void
+buffer_cache_read (disk_sector_t sector, void *buffer, off_t sector_ofs,
+		int size) {
+	struct bc_entry *e;
+
+	ASSERT (sector_ofs >= 0 && sector_ofs + size <= DISK_SECTOR_SIZE);
+
+	e = bc_get (sector, true);
+	memcpy (buffer, e->data + sector_ofs, size);
+	e->accessed = true;
+	lock_release (&e->lock);
+}
+
+/* Copies SIZE bytes from BUFFER to SECTOR_OFS within SECTOR.
+ * The sector is read from disk first only if the write covers
+ * part of it. */
+void
+buffer_cache_write (disk_sector_t sector, const void *buffer,
+		off_t sector_ofs, int size) {
+	struct bc_entry *e;
+	bool whole = sector_ofs == 0 && size == DISK_SECTOR_SIZE;
+
+	ASSERT (sector_ofs >= 0 && sector_ofs + size <= DISK_SECTOR_SIZE);
+
+	e = bc_get (sector, !whole);
+	memcpy (e->data + sector_ofs, buffer, size);
+	e->dirty = true;
+	e->accessed = true;
+	lock_release (&e->lock);
+}
+
+/* Asks the read-ahead thread to bring SECTOR into the cache.
+ * Returns immediately; does nothing if SECTOR is already cached
+ * or the request queue is full. */
+void
+buffer_cache_readahead (disk_sector_t sector) {
+	bool cached;
+
+	lock_acquire (&bc_lock);
+	cached = bc_lookup (sector) != NULL;
+	lock_release (&bc_lock);
+	if (cached)
+		return;
+
+	lock_acquire (&ra_lock);
+	if (ra_cnt < RA_QUEUE_SIZE) {
+		ra_queue[(ra_head + ra_cnt++) % RA_QUEUE_SIZE] = sector;
+		sema_up (&ra_sema);
+	}
+	lock_release (&ra_lock);
+}
+
+/* Writes every dirty entry back to disk.  Entries nobody is using
+ * are queued all at once, so the disk queue can sort and merge
+ * them.  Entries in use are written afterwards, one at a time, so
+ * we never wait for an entry lock while holding others. */
+void
+buffer_cache_flush_all (void) {
+	bool queued[BUFFER_CACHE_SIZE];
+	bool busy[BUFFER_CACHE_SIZE];
+	size_t i;
+
+	lock_acquire (&flush_lock);
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct bc_entry *e = &cache[i];
+
+		queued[i] = false;
+		busy[i] = !lock_try_acquire (&e->lock);
+		if (busy[i])
+			continue;
+		if (e->valid && e->dirty) {
+			/* 끝날 때까지 entry lock 을 쥐고 있으므로 내용이 바뀌지 않음 */
+			disk_request_init (&flush_reqs[i], filesys_disk, e->sector, e->data,
+					1, true);
+			disk_submit (&flush_reqs[i]);
+			e->dirty = false;
+			queued[i] = true;
+		} else
+			lock_release (&e->lock);
+	}
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++)
+		if (queued[i]) {
+			disk_wait (&flush_reqs[i]);
+			lock_release (&cache[i].lock);
+		}
+
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct bc_entry *e = &cache[i];
+
+		if (!busy[i])
+			continue;
+		lock_acquire (&e->lock);
+		if (e->valid && e->dirty) {
+			disk_write (filesys_disk, e->sector, e->data);
+			e->dirty = false;
+		}
+		lock_release (&e->lock);
+	}
+	lock_release (&flush_lock);
+}
+
+/* Returns the entry holding SECTOR, or NULL.  bc_lock must be
+ * held. */
+static struct bc_entry *
+bc_lookup (disk_sector_t sector) {
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&bc_lock));
+
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++)
+		if (cache[i].valid && cache[i].sector == sector)
+			return &cache[i];
+	return NULL;
+}
+
+/* Picks a victim with the clock algorithm, writes it back if it
+ * is dirty, and returns it locked.  Entries in use by other
+ * threads are skipped.  Returns NULL if every entry is in use.
+ * bc_lock must be held.  It is released during the write, so the
+ * caller must look its sector up again afterward. */
+static struct bc_entry *
+bc_evict (void) {
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&bc_lock));
+
+	/* 두 바퀴면 accessed 가 모두 지워지므로 사용 중이 아닌 entry 를 반드시 만남 */
+	for (i = 0; i < 2 * BUFFER_CACHE_SIZE; i++) {
+		struct bc_entry *e = &cache[clock_hand];
+
+		clock_hand = (clock_hand + 1) % BUFFER_CACHE_SIZE;
+		/* 복사 중 page fault 로 다시 들어온 경우 자기가 쥔 entry 도 건너뜀 */
+		if (lock_held_by_current_thread (&e->lock)
+				|| !lock_try_acquire (&e->lock))
+			continue;
+		if (e->valid && e->accessed) {
+			e->accessed = false;
+			lock_release (&e->lock);
+			continue;
+		}
+
+		/* 쓰는 동안 entry 는 옛 sector 로 valid 하게 남으므로, 그 sector 를
+		   찾는 스레드는 디스크에서 옛 내용을 읽지 않고 e->lock 에서
+		   기다린다.  다른 entry 의 조회는 막지 않도록 bc_lock 은 놓는다 */
+		if (e->valid && e->dirty) {
+			lock_release (&bc_lock);
+			disk_write (filesys_disk, e->sector, e->data);
+			lock_acquire (&bc_lock);
+		}
+		e->valid = false;
+		e->dirty = false;
+		return e;
+	}
+	return NULL;
+}
+
+/* Returns the entry holding SECTOR with its lock held.  On a miss
+ * a victim entry is taken over; its contents are read from disk
+ * only if LOAD is true, since otherwise the caller is about to
+ * overwrite the whole sector. */
+static struct bc_entry *
+bc_get (disk_sector_t sector, bool load) {
+	struct bc_entry *e;
+
+	for (;;) {
+		lock_acquire (&bc_lock);
+		e = bc_lookup (sector);
+		if (e != NULL) {
+			lock_release (&bc_lock);
+			lock_acquire (&e->lock);
+			/* 기다리는 동안 다른 sector 로 교체됐으면 다시 찾는다 */
+			if (e->valid && e->sector == sector)
+				return e;
+			lock_release (&e->lock);
+			continue;
+		}
+
+		e = bc_evict ();
+		if (e == NULL) {
+			/* 모든 entry 가 사용 중: 잠시 양보한 뒤 처음부터 */
+			lock_release (&bc_lock);
+			thread_yield ();
+			continue;
+		}
+		/* write back 하는 동안 다른 스레드가 SECTOR 를 올렸으면 그쪽을 씀 */
+		if (bc_lookup (sector) != NULL) {
+			lock_release (&e->lock);
+			lock_release (&bc_lock);
+			continue;
+		}
+		e->sector = sector;
+		e->valid = true;
+		e->accessed = false;
+		lock_release (&bc_lock);
+
+		/* 읽는 동안 같은 sector 를 찾는 스레드는 e->lock 에서 기다림 */
+		if (load)
+			disk_read (filesys_disk, sector, e->data);
+		return e;
+	}
+}
+
+/* Takes over an entry for SECTOR without reading it and returns it
+ * with its lock held.  Returns NULL if SECTOR is already cached or
+ * every entry is in use.  Never waits for an entry lock, so the
+ * caller may hold other entries. */
+static struct bc_entry *
+bc_get_new (disk_sector_t sector) {
+	struct bc_entry *e = NULL;
+
+	lock_acquire (&bc_lock);
+	if (bc_lookup (sector) == NULL) {
+		e = bc_evict ();
+		if (e != NULL && bc_lookup (sector) != NULL) {
+			lock_release (&e->lock);
+			e = NULL;
+		} else if (e != NULL) {
+			e->sector = sector;
+			e->valid = true;
+			e->accessed = false;
+		}
+	}
+	lock_release (&bc_lock);
+	return e;
+}
+
+/* Periodically writes dirty entries back so that a crash loses at
+ * most BUFFER_CACHE_FLUSH_INTERVAL ticks of writes. */
+static void
+bc_flush_daemon (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (BUFFER_CACHE_FLUSH_INTERVAL);
+		buffer_cache_flush_all ();
+	}
+}
+
+/* Loads sectors queued by buffer_cache_readahead(), up to RA_BATCH
+ * of them in flight at a time. */
+static void
+bc_readahead_daemon (void *aux UNUSED) {
+	static struct disk_request reqs[RA_BATCH];
+	struct bc_entry *entries[RA_BATCH];
+
+	for (;;) {
+		size_t cnt = 0, i;
+
+		/* 첫 요청은 기다리고, 이미 쌓인 나머지는 함께 가져감 */
+		sema_down (&ra_sema);
+		do {
+			disk_sector_t sector;
+			struct bc_entry *e;
+
+			lock_acquire (&ra_lock);
+			sector = ra_queue[ra_head];
+			ra_head = (ra_head + 1) % RA_QUEUE_SIZE;
+			ra_cnt--;
+			lock_release (&ra_lock);
+
+			/* 이미 있거나 빈 entry 가 없으면 미리 읽기는 포기 */
+			e = bc_get_new (sector);
+			if (e != NULL) {
+				disk_request_init (&reqs[cnt], filesys_disk, sector, e->data, 1,
+						false);
+				disk_submit (&reqs[cnt]);
+				entries[cnt++] = e;
+			}
+		} while (cnt < RA_BATCH && sema_try_down (&ra_sema));
+
+		/* 미리 읽은 entry 는 accessed 가 false 라서 쓰이지 않으면 먼저 쫓겨남 */
+		for (i = 0; i < cnt; i++) {
+			disk_wait (&reqs[i]);
+			lock_release (&entries[i]->lock);
+		}
+	}
+}
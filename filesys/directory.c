@@ -124,10 +124,12 @@ dir_lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	inode_dir_lock (dir->inode);
 	if (lookup (dir, name, &e, NULL))
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
+	inode_dir_unlock (dir->inode);
 
 	return *inode != NULL;
 }
@@ -151,6 +153,9 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	/* 검사부터 slot 기록까지 같은 이름이 두 번 추가되지 않도록 */
+	inode_dir_lock (dir->inode);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -174,6 +179,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	inode_dir_unlock (dir->inode);
 	return success;
 }
 
@@ -190,6 +196,8 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	inode_dir_lock (dir->inode);
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -209,6 +217,7 @@ dir_remove (struct dir *dir, const char *name) {
 	success = true;
 
 done:
+	inode_dir_unlock (dir->inode);
 	inode_close (inode);
 	return success;
 }
@@ -219,13 +228,17 @@ done:
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	struct dir_entry e;
+	bool success = false;
 
+	inode_dir_lock (dir->inode);
 	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+			success = true;
+			break;
 		}
 	}
-	return false;
+	inode_dir_unlock (dir->inode);
+	return success;
 }
@@ -1,8 +1,10 @@
 #include "filesys/fat.h"
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/buffer_cache.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include <bitmap.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -22,14 +24,18 @@ struct fat_fs {	// fat 파일시스템 정보를 담고 있는 구조체
 	unsigned int *fat;		// calloc으로 fat_length 크기만큼 할당받은 fat 배열의 주소
 	unsigned int fat_length;
 	disk_sector_t data_start;
-	cluster_t last_clst;
+	cluster_t last_clst;		// next-fit 할당을 다시 시작할 cluster
 	struct lock write_lock;
+	struct bitmap *used_map;	// cluster 당 1 bit, 사용 중(또는 쓸 수 없음)이면 1
+	size_t free_cnt;			// used_map 의 0 bit 수
 };
 
 static struct fat_fs *fat_fs;
 
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_build_used_map (void);
+static cluster_t fat_alloc_run (size_t cnt);
 
 void
 fat_init (void) {
@@ -53,6 +59,7 @@ fat_init (void) {
 
 void
 fat_open (void) {
+	free (fat_fs->fat);	// 포맷 직후라면 fat_create() 가 만든 FAT
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT load failed");
@@ -78,6 +85,7 @@ fat_open (void) {
 			free (bounce);
 		}
 	}
+	fat_build_used_map ();
 }
 
 void
@@ -126,12 +134,14 @@ fat_create (void) {
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
+	fat_build_used_map ();
 
 	// Fill up ROOT_DIR_CLUSTER region with 0
 	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
 	if (buf == NULL)
 		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
+	buffer_cache_write (cluster_to_sector (ROOT_DIR_CLUSTER), buf, 0,
+			DISK_SECTOR_SIZE);
 	free (buf);
 }
 
@@ -165,6 +175,57 @@ fat_fs_init (void) {
 	
 	// 파일이 들어있는 시작 섹터 -> data 저장하는 시작지점
 	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;		
+
+	// 클러스터 할당/해제를 직렬화하는 lock
+	lock_init (&fat_fs->write_lock);
+}
+
+/* Rebuilds the in-memory map of used clusters from the FAT.
+ * Cluster 0 is never handed out, and clusters past the end of the
+ * disk are marked used even though the FAT has room for them. */
+static void
+fat_build_used_map (void) {
+	size_t data_clusters = (fat_fs->bs.total_sectors - fat_fs->data_start)
+		/ SECTORS_PER_CLUSTER;
+	cluster_t clst;
+
+	if (data_clusters > fat_fs->fat_length)
+		data_clusters = fat_fs->fat_length;
+
+	bitmap_destroy (fat_fs->used_map);
+	fat_fs->used_map = bitmap_create (fat_fs->fat_length);
+	if (fat_fs->used_map == NULL)
+		PANIC ("FAT used map creation failed");
+
+	bitmap_mark (fat_fs->used_map, 0);
+	bitmap_set_multiple (fat_fs->used_map, data_clusters,
+			fat_fs->fat_length - data_clusters, true);
+	for (clst = 1; clst < data_clusters; clst++)
+		if (fat_get (clst) != 0)
+			bitmap_mark (fat_fs->used_map, clst);
+	fat_fs->free_cnt = bitmap_count (fat_fs->used_map, 0, fat_fs->fat_length,
+			false);
+	fat_fs->last_clst = ROOT_DIR_CLUSTER + 1;
+}
+
+/* Takes CNT consecutive free clusters, searching next-fit from
+ * last_clst and wrapping around once, and returns the first one.
+ * Returns 0 if there is no such run.  write_lock must be held. */
+static cluster_t
+fat_alloc_run (size_t cnt) {
+	size_t idx;
+
+	ASSERT (lock_held_by_current_thread (&fat_fs->write_lock));
+
+	idx = bitmap_scan_and_flip (fat_fs->used_map, fat_fs->last_clst, cnt,
+			false);
+	if (idx == BITMAP_ERROR)
+		idx = bitmap_scan_and_flip (fat_fs->used_map, 0, cnt, false);
+	if (idx == BITMAP_ERROR)
+		return 0;
+	fat_fs->last_clst = idx + cnt;
+	fat_fs->free_cnt -= cnt;
+	return idx;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -179,39 +240,57 @@ fat_create_chain (cluster_t clst) {
 	/* TODO: Your code goes here. */
 	// clst(클러스터 인덱싱 번호)로 특정된 클러스터의 뒤에 클러스터를 추가하여 체인을 확장함
 	// 새로 할당된 클러스터의 번호를 반환합니다.
+	return fat_create_chain_n (clst, 1);
+}
 
-	// clst가 0이면, 새 체인을 만든다 
-	if (clst == 0) {
-		// fat에서 값이 0인(빈) 클러스터를 찾아서 새로 체인을 만든다.
-		for (cluster_t i = 2; i<fat_fs->fat_length; i++) {// i는 2부터 fat_length만큼 
-			if (fat_get(i) == 0) {	
-				fat_put(i, EOChain);
-				return i;
-			}
-		}
-	}
+/* Adds CNT clusters to the chain, consecutive on disk if such a run
+ * is free.  If CLST is 0, start a new chain.
+ * Returns the first new cluster, or 0 if CNT clusters could not be
+ * allocated, in which case the FAT is left unchanged. */
+cluster_t
+fat_create_chain_n (cluster_t clst, size_t cnt) {
+	cluster_t first = 0;
+	size_t i;
+
+	// 빈 클러스터를 찾고 체인에 붙이는 사이에 다른 스레드가 끼어들지 않도록
+	// FAT 할당은 write_lock 으로 직렬화한다.
+	lock_acquire (&fat_fs->write_lock);
 
 	// clst가 0이 아니면, clst 클러스터 뒤에 클러스터를 추가한다. 
-	else {		
-		// clst 클러스터는 항상 마지막 클러스터이어야 함
-		cluster_t next_clst_idx = fat_get(clst);	
-		if (next_clst_idx != EOChain) {	
-			return 0;
-		}
+	// clst 클러스터는 항상 마지막 클러스터이어야 함
+	if (cnt == 0 || cnt > fat_fs->free_cnt
+			|| (clst != 0 && fat_get (clst) != EOChain))
+		goto done;
+
+	// 새 클러스터들을 먼저 EOChain 으로 끝나는 체인으로 만든 뒤 clst 뒤에
+	// 연결한다.  (lock 없이 체인을 따라가는 reader 가 0 을 보지 않도록)
+	first = fat_alloc_run (cnt);
+	if (first != 0) {
+		for (i = 0; i + 1 < cnt; i++)
+			fat_put (first + i, first + i + 1);
+		fat_put (first + cnt - 1, EOChain);
+	} else {
+		// 연속된 빈 구간이 없으면 하나씩.  free_cnt 를 봤으므로 실패하지 않음
+		cluster_t prev = 0;
 
-		// 빈 클러스터 찾기
-		cluster_t new_clst; 
-		for (cluster_t i = 2; i<fat_fs->fat_length; i++) {
-			if (fat_get(i) == 0) {	
-				new_clst = i;
-				break;
-			}
+		for (i = 0; i < cnt; i++) {
+			cluster_t new_clst = fat_alloc_run (1);
+
+			ASSERT (new_clst != 0);
+			fat_put (new_clst, EOChain);
+			if (prev != 0)
+				fat_put (prev, new_clst);
+			else
+				first = new_clst;
+			prev = new_clst;
 		}
-		// clst 클러스터 뒤에 클러스터를 추가
-		fat_put(clst, new_clst);
-		fat_put(new_clst, EOChain);
-		return new_clst;	// 새로 할당된 클러스터의 번호를 반환
 	}
+	if (clst != 0)
+		fat_put (clst, first);
+
+done:
+	lock_release (&fat_fs->write_lock);
+	return first;	// 새로 할당된 첫 클러스터의 번호를 반환
 }
 
 /* Remove the chain of clusters starting from CLST.
@@ -224,9 +303,11 @@ fat_remove_chain (cluster_t clst, cluster_t pclst) {
 	// 즉, 이 함수가 실행된 후에,pclst는 업데이트된 체인의 마지막 요소가 될 것입니다. 
 	// 만약 clst가 체인의 첫 요소라면, pclst는 0이 되어야 합니다.
 	
+	lock_acquire (&fat_fs->write_lock);
 	if(pclst != 0) {	// clst가 체인의 첫 요소가 아니라면 if문 진입
 		// pclst는 체인에서 clst의 바로 이전 클러스터여야 함
 		if(fat_get(pclst) != clst) {
+			lock_release (&fat_fs->write_lock);
 			return;
 		}
 		// pclst가 체인의 마지막 요소가 되어야 함
@@ -238,9 +319,12 @@ fat_remove_chain (cluster_t clst, cluster_t pclst) {
 	while(true) {	
 		next_clst = fat_get(clst);
 		fat_put(clst, 0);					// clst의 val을 0으로 바꾼다. 
+		bitmap_reset (fat_fs->used_map, clst);
+		fat_fs->free_cnt++;
 		if (next_clst == EOChain) break;	// 마지막 클러스터이라면 break
 		clst = next_clst;
 	}	
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
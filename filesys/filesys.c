@@ -8,6 +8,10 @@
 #include "filesys/directory.h"
 #include "devices/disk.h"
 #include "filesys/fat.h"
+#include "filesys/buffer_cache.h"
+#ifdef EFILESYS
+#include "filesys/page_cache.h"
+#endif
 #include "threads/thread.h"
 
 /* The disk that contains the file system. */
@@ -23,6 +27,7 @@ void filesys_init(bool format)
 	if (filesys_disk == NULL)
 		PANIC("hd0:1 (hdb) not present, file system initialization failed");
 
+	buffer_cache_init();
 	inode_init();
 
 #ifdef EFILESYS
@@ -52,6 +57,12 @@ void filesys_init(bool format)
  * to disk. */
 void filesys_done(void)
 {
+	/* 캐시에 남은 dirty page, sector 를 먼저 디스크로 */
+#ifdef EFILESYS
+	page_cache_done();
+#endif
+	buffer_cache_done();
+
 	/* Original FS */
 #ifdef EFILESYS
 	fat_close();
@@ -6,11 +6,20 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "filesys/fat.h"
+#include "filesys/buffer_cache.h"
+#ifdef EFILESYS
+#include "filesys/page_cache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Largest run of clusters reserved ahead of a growing file. */
+#define INODE_PREALLOC_MAX 256
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk
@@ -44,56 +53,151 @@ struct inode
 	bool removed;												/* True if deleted, false otherwise. */
 	int deny_write_cnt;											/* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;										/* Inode content. */
+	struct lock lock;											/* 쓰기, length 변경, deny_write_cnt 보호 */
+	struct lock dir_lock;										/* 디렉토리일 때 엔트리 변경 보호 */
+
+	/* 데이터 cluster chain 의 index.  clusters[i] 는 chain 의 i 번째 cluster.
+	   처음 필요할 때 FAT 를 따라 만들고, chain 이 늘어나면 뒤에 덧붙인다.
+	   chain 이 줄어드는 경우(삭제)는 inode 가 닫힐 때뿐이라 같이 버려짐 */
+	cluster_t *clusters;										/* Chain index, NULL until first use. */
+	size_t cluster_cnt;											/* Entries of CLUSTERS in use. */
+	size_t cluster_cap;											/* Entries allocated. */
+	struct rwlock map_lock;										/* CLUSTERS 보호 */
+
+	/* 파일이 늘어날 때 끝에 미리 붙여 두는 cluster 수.  늘어날 때마다 두 배
+	   (최대 INODE_PREALLOC_MAX) 가 되어 순차 쓰기 파일은 연속된 구간을 받음.
+	   length 뒤에 남은 cluster 는 마지막 inode_close() 에서 돌려줌 */
+	size_t prealloc_window;										/* map_lock 으로 보호 */
+	bool preallocated;											/* Chain may run past length. */
 };
 
+/* Makes INODE's cluster index cover the first IDX + 1 clusters of
+ * its chain, following the FAT from the last indexed cluster.  If
+ * GROW, the chain itself is extended when it is too short.
+ * Returns false if the chain is too short and GROW is false, or if
+ * memory or disk allocation fails.  map_lock must be held for
+ * writing. */
+static bool
+inode_map_extend(struct inode *inode, size_t idx, bool grow)
+{
+	ASSERT(rwlock_held_for_write(&inode->map_lock));
+
+	while (inode->cluster_cnt <= idx)
+	{
+		cluster_t next;
+
+		if (inode->cluster_cnt == inode->cluster_cap)
+		{
+			size_t cap = inode->cluster_cap ? inode->cluster_cap * 2 : 16;
+			cluster_t *clusters = realloc(inode->clusters, cap * sizeof *clusters);
+			if (clusters == NULL)
+				return false;
+			inode->clusters = clusters;
+			inode->cluster_cap = cap;
+		}
+
+		if (inode->cluster_cnt == 0)
+			next = sector_to_cluster(inode->data.start);
+		else
+		{
+			cluster_t last = inode->clusters[inode->cluster_cnt - 1];
+			next = fat_get(last);
+			if (next == EOChain)
+			{
+				///// file grow: 모자란 cluster 에 window 만큼 더 붙여서 한 번에 추가
+				size_t need = idx + 1 - inode->cluster_cnt;
+				size_t window = inode->prealloc_window * 2;
+
+				if (!grow)
+					return false;
+				if (window < need)
+					window = need;
+				if (window > INODE_PREALLOC_MAX)
+					window = INODE_PREALLOC_MAX;
+				inode->prealloc_window = window;
+
+				next = 0;
+				if (window > need)
+				{
+					next = fat_create_chain_n(last, window);
+					inode->preallocated |= next != 0;
+				}
+				if (next == 0) /* 디스크가 부족하면 필요한 만큼만 */
+					next = fat_create_chain_n(last, need);
+				if (next == 0)
+					return false;
+			}
+		}
+		inode->clusters[inode->cluster_cnt++] = next;
+	}
+	return true;
+}
+
 /* Returns the disk sector that contains byte offset POS within
- * INODE.
+ * INODE, looked up in INODE's cluster index.  If GROW, the cluster
+ * chain is extended to reach POS.
  * Returns -1 if INODE does not contain data for a byte at offset
- * POS. */
+ * POS (and GROW is false), or if the chain could not be extended. */
 static disk_sector_t
-byte_to_sector(const struct inode *inode, off_t pos)
+byte_to_sector(struct inode *inode, off_t pos, bool grow)
 {
+	size_t sector = pos / DISK_SECTOR_SIZE;
+	size_t idx = sector / SECTORS_PER_CLUSTER;
+	disk_sector_t result = -1;
+
 	ASSERT(inode != NULL);
-	// 기존에는 그냥 다음 sector를 찾아가게 만들었음
-	//////// 기존 코드 start
-	// if (pos < inode->data.length)
-	// 	return inode->data.start + pos / DISK_SECTOR_SIZE;
-	// else
-	// 	return -1;
-	/////// 기존 코드 end
-
-	//------project4-start-----------------------
-
-	// fat을 보고 inode 찾아가게 만들기
-	// if (pos < inode->data.length) {
-	cluster_t start_clust = sector_to_cluster(inode->data.start); // start의 cluster index 받기
-	while (pos >= DISK_SECTOR_SIZE)
-	{ // pos가 속한 cluster 찾기
-		///// file grow
-		if (fat_get(start_clust) == EOChain)
-		{								   // start_clust가 마지막 cluster이면
-			fat_create_chain(start_clust); // 체인 하나 추가
-		}
-		//// file grow
-		start_clust = fat_get(start_clust); // 다음 cluster 받기
-		pos -= DISK_SECTOR_SIZE;
+	ASSERT(pos >= 0);
+
+	/* 대부분은 이미 index 에 있으므로 read lock 만으로 끝남 */
+	rwlock_acquire_read(&inode->map_lock);
+	if (idx < inode->cluster_cnt)
+		result = cluster_to_sector(inode->clusters[idx]) + sector % SECTORS_PER_CLUSTER;
+	rwlock_release_read(&inode->map_lock);
+	if (result != (disk_sector_t)-1)
+		return result;
+
+	rwlock_acquire_write(&inode->map_lock);
+	if (inode_map_extend(inode, idx, grow))
+		result = cluster_to_sector(inode->clusters[idx]) + sector % SECTORS_PER_CLUSTER;
+	rwlock_release_write(&inode->map_lock);
+	return result;
+}
+
+/* Gives back the clusters INODE reserved past its end of file,
+ * keeping at least one cluster.  Called on the last close. */
+static void
+inode_release_prealloc(struct inode *inode)
+{
+	size_t keep = DIV_ROUND_UP(bytes_to_sectors(inode->data.length), SECTORS_PER_CLUSTER);
+
+	if (!inode->preallocated)
+		return;
+	if (keep == 0)
+		keep = 1;
+
+	rwlock_acquire_write(&inode->map_lock);
+	/* clusters[keep] 가 있으면 거기부터가 남는 cluster */
+	if (inode_map_extend(inode, keep, false))
+	{
+		fat_remove_chain(inode->clusters[keep], inode->clusters[keep - 1]);
+		inode->cluster_cnt = keep;
 	}
-	return cluster_to_sector(start_clust);
-	// }
-	// else
-	// 	return -1;
-	//------project4-end--------------------------
+	inode->preallocated = false;
+	rwlock_release_write(&inode->map_lock);
 }
 
 /* List of open inodes, so that opening a single inode twice
  * returns the same `struct inode'. */
 // in-memory inode 전역변수 (Double linked list)
 static struct list open_inodes;
+/* open_inodes 와 각 inode 의 open_cnt 보호 */
+static struct lock open_inodes_lock;
 
 /* Initializes the inode module. */
 void inode_init(void)
 {
 	list_init(&open_inodes);
+	lock_init(&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -126,41 +230,27 @@ bool inode_create(disk_sector_t sector, off_t length, uint32_t is_dir)
 		disk_inode->is_dir = is_dir; // inode 생성 시, 파일,디렉터리 구분을 위한 필드를 is_dir인자 값으로 설정
 
 		//------project4-start--------------------------------------------
-		cluster_t new_cluster = fat_create_chain(0); // 새로운 체인 만들기
+		// sectors 개수만큼(최소 1개) 클러스터 체인을 한 번에 만들기
+		cluster_t new_cluster = fat_create_chain_n(0, sectors > 0 ? sectors : 1);
 		if (new_cluster == 0)
 		{ // 체인 만들기에 실패한 경우, 예외처리
 			free(disk_inode);
 			return success;
 		}
 		disk_inode->start = cluster_to_sector(new_cluster); // 새로운 체인을 만든 뒤에 해당 주소를 disk_inode->start값에 넣어주기
-		disk_write(filesys_disk, sector, disk_inode);		// inode의 구조체(메타데이터) disk에 쓰기
+		buffer_cache_write(sector, disk_inode, 0, DISK_SECTOR_SIZE); // inode의 구조체(메타데이터) disk에 쓰기
 
 		// inode(진짜 데이터들)를 저장하는 클러스터 체인을 모두 0으로 초기화
 		if (sectors > 0)
 		{
-			//////////
-			cluster_t clst = sector_to_cluster(disk_inode->start);
-			cluster_t next_clst;
-			// sectors 개수만큼 클러스터 체인을 만들기
-			for (size_t i = 1; i < sectors; i++)
-			{
-				next_clst = fat_create_chain(clst);
-				if (next_clst == 0)
-				{ // 체인 만들기에 실패한 경우 예외처리
-					free(disk_inode);
-					return success;
-				}
-				clst = next_clst;
-			}
-			//////////
 			static char zeros[DISK_SECTOR_SIZE];
+			cluster_t clst = new_cluster;
 			size_t i;
-			disk_sector_t old_disk_sector = disk_inode->start;
-			disk_sector_t new_disk_sector;
 			for (i = 0; i < sectors; i++)
-				disk_write(filesys_disk, old_disk_sector, zeros);
-			new_disk_sector = cluster_to_sector(fat_get(sector_to_cluster(old_disk_sector)));
-			old_disk_sector = new_disk_sector;
+			{
+				buffer_cache_write(cluster_to_sector(clst), zeros, 0, DISK_SECTOR_SIZE);
+				clst = fat_get(clst);
+			}
 		}
 		free(disk_inode); // mem에서 잠깐 사용한 temp buffer 느낌이므로 free해주기
 		success = true;
@@ -192,6 +282,7 @@ inode_open (disk_sector_t sector) {   // 해야할 부분 p.543
 	struct list_elem *e;
 	struct inode *inode;
 
+	lock_acquire(&open_inodes_lock);
 	/* Check whether this inode is already open. */
 	for (e = list_begin(&open_inodes); e != list_end(&open_inodes);
 		 e = list_next(e))
@@ -199,7 +290,8 @@ inode_open (disk_sector_t sector) {   // 해야할 부분 p.543
 		inode = list_entry(e, struct inode, elem);
 		if (inode->sector == sector)
 		{
-			inode_reopen(inode);
+			inode->open_cnt++;
+			lock_release(&open_inodes_lock);
 			return inode;
 		}
 	}
@@ -207,7 +299,10 @@ inode_open (disk_sector_t sector) {   // 해야할 부분 p.543
 	/* Allocate memory. */
 	inode = malloc(sizeof *inode);
 	if (inode == NULL)
+	{
+		lock_release(&open_inodes_lock);
 		return NULL;
+	}
 
 	/* Initialize. */
 	list_push_front(&open_inodes, &inode->elem);
@@ -215,7 +310,16 @@ inode_open (disk_sector_t sector) {   // 해야할 부분 p.543
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read(filesys_disk, inode->sector, &inode->data);
+	lock_init(&inode->lock);
+	lock_init(&inode->dir_lock);
+	inode->clusters = NULL;
+	inode->cluster_cnt = inode->cluster_cap = 0;
+	rwlock_init(&inode->map_lock);
+	inode->prealloc_window = 0;
+	inode->preallocated = false;
+	/* 다른 스레드가 list 에서 찾기 전에 내용을 채워 둠 */
+	buffer_cache_read(inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	lock_release(&open_inodes_lock);
 	return inode;
 }
 
@@ -224,7 +328,11 @@ struct inode *
 inode_reopen(struct inode *inode)
 {
 	if (inode != NULL)
+	{
+		lock_acquire(&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release(&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -245,6 +353,7 @@ void inode_close(struct inode *inode)
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire(&open_inodes_lock);
 	if (--inode->open_cnt == 0)
 	{ // open_cnt가 0일 경우에만 inode를 삭제해준다.
 		/* Remove from inode list and release lock. */
@@ -256,8 +365,12 @@ void inode_close(struct inode *inode)
 			fat_remove_chain(sector_to_cluster(inode->sector), 0);	   // inode 구조체(메타데이터) fat에서 제거
 			fat_remove_chain(sector_to_cluster(inode->data.start), 0); // inode 실제 데이터들 모두를 fat에서 제거
 		}
+		else
+			inode_release_prealloc(inode); // length 뒤로 미리 잡아 둔 cluster 반환
 		// 기존 파일 크기보다 더 크게 write를 한 경우, disk에 업데이트 해 주어야 함
-		disk_write(filesys_disk, inode->sector, &inode->data);
+		// (같은 sector 를 다시 여는 inode_open 이 옛 내용을 읽지 않도록 lock 안에서)
+		buffer_cache_write(inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+		free(inode->clusters);
 		free(inode);
 		//------project4-end--------------------------
 
@@ -270,6 +383,7 @@ void inode_close(struct inode *inode)
 		// }
 		//////// 기존 코드 end
 	}
+	lock_release(&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -280,18 +394,46 @@ void inode_remove(struct inode *inode)
 	inode->removed = true;
 }
 
+/* BUFFER 가 user 주소면 SIZE 바이트가 걸친 페이지를 미리 한 번씩 건드려서
+ * page fault 를 지금 일으켜 둔다.  캐시 lock 을 쥔 채로 memcpy 하다가 fault 가
+ * 나면, fault handler 가 파일을 읽으면서 같은 lock 을 다시 잡으려 할 수 있음.
+ * WRITE 면 쓰기로 건드려서 쓰기 가능한 페이지로 만들어 둔다. */
+static void
+prefault_buffer(const void *buffer, off_t size, bool write)
+{
+	const uint8_t *p = buffer;
+	const uint8_t *end = p + size;
+
+	if (size <= 0 || !is_user_vaddr(buffer))
+		return;
+	while (p < end)
+	{
+		volatile uint8_t *v = (volatile uint8_t *)p;
+		if (write)
+			*v = *v;
+		else
+			(void)*v;
+		p = (const uint8_t *)pg_round_down(p) + PGSIZE;
+	}
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
+ * than SIZE if an error occurs or end of file is reached.
+ * Pages of INODE that are in the page cache are read from there;
+ * everything else comes through the buffer cache, which is also
+ * asked to prefetch the sector after the last one read. */
 off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
+	off_t next;
+
+	prefault_buffer(buffer, size, true);
 	while (size > 0)
 	{
 		/* Disk sector to read, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector(inode, offset);
+		disk_sector_t sector_idx;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -304,64 +446,76 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
-		{
-			/* Read full sector directly into caller's buffer. */
-			disk_read(filesys_disk, sector_idx, buffer + bytes_read);
-		}
-		else
-		{
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL)
-			{
-				bounce = malloc(DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read(filesys_disk, sector_idx, bounce);
-			memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		/* 읽기는 chain 을 늘리지 않음.  파일 끝 검사 뒤에 찾아야 함 */
+		sector_idx = byte_to_sector(inode, offset, false);
+		if (sector_idx == (disk_sector_t)-1)
+			break;
+#ifdef EFILESYS
+		if (!page_cache_read(inode, buffer + bytes_read, offset, chunk_size))
+#endif
+			buffer_cache_read(sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free(bounce);
+
+	/* 순차 읽기라고 보고 다음 sector 를 미리 읽어 둠 */
+	if (bytes_read > 0)
+	{
+		next = ((offset - 1) / DISK_SECTOR_SIZE + 1) * DISK_SECTOR_SIZE;
+		if (next < inode_length(inode))
+		{
+			disk_sector_t sector = byte_to_sector(inode, next, false);
+			if (sector != (disk_sector_t)-1)
+				buffer_cache_readahead(sector);
+		}
+	}
 	return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
  * Returns the number of bytes actually written, which may be
  * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * A write past end of file extends the inode.
+ *
+ * Writers to the same inode are serialized by INODE's lock.
+ * Readers do not take it: the new length is published only after
+ * the clusters and data behind it are in place, so a concurrent
+ * inode_read_at() sees either the old or the new length, never
+ * sectors that do not exist yet. */
 off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
 					 off_t offset)
 {
 	// printf("===========wirte at 들어옴\n");
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
+	off_t length;
 
+	prefault_buffer(buffer, size, false);
+	lock_acquire(&inode->lock);
 	if (inode->deny_write_cnt)
+	{
+		lock_release(&inode->lock);
 		return 0;
+	}
 
 	// 만약 write를 통해서 file의 크기가 늘어나야 한다면, offset+size만큼 file의 크기 늘려주기
-	if (offset + size > inode->data.length)
+	length = inode->data.length;
+	if (offset + size > length)
 	{
-		inode->data.length = offset + size;
+		length = offset + size;
 	}
 
 	while (size > 0)
 	{
 		/* Sector to write, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector(inode, offset);
+		disk_sector_t sector_idx;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
-		off_t inode_left = inode_length(inode) - offset;
+		off_t inode_left = length - offset;
 		int sector_left = DISK_SECTOR_SIZE - sector_ofs;
 		int min_left = inode_left < sector_left ? inode_left : sector_left; // file의 크기보다 더 크게 쓸 수 있도록 해야 함
 
@@ -370,46 +524,70 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {    // 한 섹터 전체에 write
-			/* Write full sector directly to disk. */
-			disk_write(filesys_disk, sector_idx, buffer + bytes_written);
-		}
-		else
-		{
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {     
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
+		/* 필요하면 cluster chain 을 늘림.  디스크가 가득 차면 여기까지만 씀 */
+		sector_idx = byte_to_sector(inode, offset, true);
+		if (sector_idx == (disk_sector_t)-1)
+			break;
 
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left)
-				disk_read(filesys_disk, sector_idx, bounce);
-			else
-				memset(bounce, 0, DISK_SECTOR_SIZE);
-			memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write(filesys_disk, sector_idx, bounce);
-		}
+		/* 섹터 일부만 쓰는 경우의 read-modify-write 는 buffer cache 가 처리 */
+#ifdef EFILESYS
+		if (!page_cache_write(inode, buffer + bytes_written, offset, chunk_size))
+#endif
+			buffer_cache_write(sector_idx, buffer + bytes_written, sector_ofs, chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free(bounce);
+
+	/* 실제로 쓴 곳까지만 length 를 늘려서 reader 에게 보여줌 */
+	if (offset > inode->data.length)
+		inode->data.length = offset;
+	lock_release(&inode->lock);
 
 	return bytes_written;
 }
 
+/* Writes SIZE bytes from BUFFER into INODE at OFFSET, stopping at
+ * the current end of file.  Used by the page cache to write its
+ * pages back: it skips the page cache and takes no inode lock, so
+ * it can be called with the page cache lock held.  Returns the
+ * number of bytes written. */
+off_t inode_writeback_at(struct inode *inode, const void *buffer_, off_t size,
+						 off_t offset)
+{
+	const uint8_t *buffer = buffer_;
+	off_t length = inode_length(inode);
+	off_t bytes_written = 0;
+
+	if (offset + size > length)
+		size = length > offset ? length - offset : 0;
+	while (size > 0)
+	{
+		disk_sector_t sector_idx = byte_to_sector(inode, offset, false);
+		int sector_ofs = offset % DISK_SECTOR_SIZE;
+		int sector_left = DISK_SECTOR_SIZE - sector_ofs;
+		int chunk_size = size < sector_left ? size : sector_left;
+
+		if (sector_idx == (disk_sector_t)-1)
+			break;
+		buffer_cache_write(sector_idx, buffer + bytes_written, sector_ofs, chunk_size);
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+	}
+	return bytes_written;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void inode_deny_write(struct inode *inode)
 {
+	lock_acquire(&inode->lock);
 	inode->deny_write_cnt++;
 	ASSERT(inode->deny_write_cnt <= inode->open_cnt);
+	lock_release(&inode->lock);
 }
 
 /* Re-enables writes to INODE.
@@ -417,10 +595,12 @@ void inode_deny_write(struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void inode_allow_write(struct inode *inode)
 {
+	lock_acquire(&inode->lock);
 	ASSERT(inode->deny_write_cnt > 0);
 	ASSERT(inode->deny_write_cnt <= inode->open_cnt);
 
 	inode->deny_write_cnt--;
+	lock_release(&inode->lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -434,18 +614,39 @@ off_t inode_length(const struct inode *inode)
 // fd의 in-memory inode가 디렉터리 인지 판단하여 성공여부 반환
 bool inode_is_dir(const struct inode *inode)
 {
-	bool result;
-	/* inode_disk 자료구조를 메모리에 할당 */
-	struct inode_disk *disk_inode = calloc(1, sizeof *disk_inode);
+	/* inode_open() 에서 on-disk inode 를 inode->data 로 이미 읽어 두었음 */
+	return inode->data.is_dir; // 1 or 0이 있을거임.
+}
+
+/* 디렉토리 INODE 의 엔트리를 읽거나 바꾸는 동안 잡는 lock.
+   같은 디렉토리를 여러 struct dir 로 열어도 inode 는 하나이므로
+   디렉토리마다 하나의 lock 이 됨 */
+void inode_dir_lock(struct inode *inode)
+{
+	lock_acquire(&inode->dir_lock);
+}
+
+void inode_dir_unlock(struct inode *inode)
+{
+	lock_release(&inode->dir_lock);
+}
 
-	/* in-memory inode의 on-disk inode를 읽어 inode_disk에 저장 */
-	disk_read(filesys_disk,cluster_to_sector(inode->sector),disk_inode);
- 
-	/* on-disk inode의 is_dir을 result에 저장하여 반환 */
-	result = disk_inode->is_dir; // 1 or 0이 있을거임.
+/* INODE 에 쓰는 스레드(inode_write_at)를 막는 lock.  page cache 가 파일
+   page 를 읽어서 cache 에 넣는 동안 잡는다 */
+void inode_lock(struct inode *inode)
+{
+	lock_acquire(&inode->lock);
+}
 
+void inode_unlock(struct inode *inode)
+{
+	lock_release(&inode->lock);
+}
 
-	return result;
+/* 현재 스레드가 INODE 에 쓰는 중인지 (inode_write_at 도중의 page fault) */
+bool inode_lock_held(struct inode *inode)
+{
+	return lock_held_by_current_thread(&inode->lock);
 }
 
 //------project4-end-----------------------------------------------------
@@ -1,9 +1,35 @@
-/* page_cache.c: Implementation of Page Cache (Buffer Cache). */
+/* page_cache.c: Implementation of Page Cache (Buffer Cache).
+ *
+ * Pages of files that are mmap'd are cached here, one frame per
+ * (inode, page offset).  Every mapping of that file page shares the
+ * frame, and inode_read_at()/inode_write_at() go through it while it
+ * is cached, so mmap and read()/write() always see the same bytes.
+ * Frames come from the frame table like any other page and are
+ * given back through page_cache_writeback() when they are evicted.
+ *
+ * page_cache_kworkerd prefetches the page after each newly mapped
+ * one, sleeping until a request arrives, and page_cache_flushd
+ * writes dirty pages back every PAGE_CACHE_WRITEBACK_TICKS while
+ * anything is cached.
+ * Cached pages are never accessed through a user page table entry
+ * of their own, so the eviction clock takes unmapped ones first. */
 
 #include "vm/vm.h"
+#include <hash.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+#ifdef EFILESYS
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_kworkerd (void *aux);
+static void page_cache_flushd (void *aux);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -15,36 +41,576 @@ static const struct page_operations page_cache_op = {
 
 tid_t page_cache_workerd;
 
+/* Cached pages, by (inode, offset) in `page_caches' and in one list
+ * for flushd's passes.  page_cache_lock protects both, every
+ * struct page_cache, and the `cache' links of VM_FILE pages.
+ *
+ * Lock order: inode lock -> page_cache_lock -> buffer cache.
+ * Nothing that may allocate a frame or fault runs with
+ * page_cache_lock held, since eviction can land in
+ * page_cache_writeback().  So page_cache_read()/page_cache_write()
+ * only count themselves in `users' under the lock and copy after
+ * releasing it; page_cache_writeback() marks the page `evicting',
+ * so that lookups stop returning it, and waits on page_cache_cond
+ * until no copy is left.  Lookups of an evicting page wait on the
+ * same condition until it has left the cache. */
+static struct hash page_caches;
+static struct list page_cache_list;
+static struct lock page_cache_lock;
+static struct condition page_cache_cond;
+
+/* read-ahead 요청 큐 (page_cache_lock 으로 보호).  가득 차면 버린다. */
+#define RA_QUEUE_SIZE 8
+static struct {
+	struct inode *inode;        /* 요청 동안 reference 를 쥠 */
+	off_t ofs;
+} ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head;
+static size_t ra_cnt;
+
+/* kworkerd 는 read-ahead 요청이 없으면, flushd 는 cache 가 비어 있으면
+   여기서 잠듦 */
+static struct semaphore kworker_sema;
+static bool kworker_idle;
+static struct semaphore flushd_sema;
+static bool flushd_idle;
+
+static uint64_t page_cache_hash (const struct hash_elem *, void *aux);
+static bool page_cache_less (const struct hash_elem *,
+		const struct hash_elem *, void *aux);
+static struct page *page_cache_lookup (struct inode *, off_t ofs);
+static struct page *page_cache_get (struct inode *, off_t ofs);
+static void page_cache_put (struct page *page);
+static bool page_cache_load (struct inode *, off_t ofs, bool evict);
+static void page_cache_request (struct inode *, off_t ofs);
+static void page_cache_wake (struct semaphore *, bool *idle);
+static void page_cache_unmap_all (struct page *page);
+static void page_cache_write_back (struct page *page);
+static void page_cache_sweep (void);
+
 /* The initializer of file vm */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	hash_init (&page_caches, page_cache_hash, page_cache_less, NULL);
+	list_init (&page_cache_list);
+	lock_init (&page_cache_lock);
+	cond_init (&page_cache_cond);
+	ra_head = ra_cnt = 0;
+	sema_init (&kworker_sema, 0);
+	kworker_idle = false;
+	sema_init (&flushd_sema, 0);
+	flushd_idle = false;
+
+	page_cache_workerd = thread_create ("page_cache_kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	thread_create ("page_cache_flushd", PRI_DEFAULT, page_cache_flushd, NULL);
+}
+
+/* Writes every dirty cached page back to its file.  Called at
+ * shutdown, before the buffer cache is flushed. */
+void
+page_cache_done (void) {
+	struct list_elem *e;
+
+	lock_acquire (&page_cache_lock);
+	for (e = list_begin (&page_cache_list); e != list_end (&page_cache_list);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, page_cache.elem);
+
+		page_cache_unmap_all (page);
+		if (page->page_cache.dirty)
+			page_cache_write_back (page);
+	}
+	lock_release (&page_cache_lock);
 }
 
 /* Initialize the page cache */
 bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
+page_cache_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &page_cache_op;
+	return true;
+}
+
+/* Maps the cached page of INODE at OFS into the current process at
+ * PAGE->va, loading it first if needed.  PAGE must be a VM_FILE
+ * page.  Also asks kworkerd to prefetch the following page. */
+bool
+page_cache_map (struct page *page, struct inode *inode, off_t ofs) {
+	struct thread *curr = thread_current ();
+	struct page *cached;
+
+	ASSERT (VM_TYPE (page->operations->type) == VM_FILE);
+	ASSERT (ofs % PGSIZE == 0);
+
+	for (;;) {
+		lock_acquire (&page_cache_lock);
+		cached = page_cache_lookup (inode, ofs);
+		if (cached != NULL)
+			break;
+		lock_release (&page_cache_lock);
+
+		/* 읽어 온 직후 바로 쫓겨날 수도 있으니 다시 찾는다 */
+		if (!page_cache_load (inode, ofs, true))
+			return false;
+	}
 
+	if (!pml4_set_page (curr->pml4, page->va, cached->frame->kva,
+				page->writable)) {
+		lock_release (&page_cache_lock);
+		return false;
+	}
+	page->frame = cached->frame;
+	page->file.cache = cached;
+	page->file.pml4 = curr->pml4;
+	list_push_back (&cached->page_cache.mappings, &page->file.cache_elem);
+	lock_release (&page_cache_lock);
+
+	if (ofs + PGSIZE < inode_length (inode))
+		page_cache_request (inode, ofs + PGSIZE);
+	return true;
+}
+
+/* Removes PAGE's mapping of its cached frame, if any.  What the
+ * process wrote stays in the page cache and reaches the file on the
+ * next writeback. */
+void
+page_cache_unmap (struct page *page) {
+	struct page *cached;
+
+	lock_acquire (&page_cache_lock);
+	cached = page->file.cache;
+	if (cached != NULL) {
+		if (pml4_is_dirty (page->file.pml4, page->va))
+			cached->page_cache.dirty = true;
+		pml4_clear_page (page->file.pml4, page->va);
+		list_remove (&page->file.cache_elem);
+		page->file.cache = NULL;
+		page->frame = NULL;
+	}
+	lock_release (&page_cache_lock);
+}
+
+/* Returns true if a mapping of cached PAGE was accessed since the
+ * previous call, and clears the accessed bits.  The eviction clock
+ * calls this with frame_lock held, which comes after page_cache_lock
+ * in the lock order, so page_cache_lock is only tried; while it is
+ * busy PAGE counts as accessed.  So does a page being copied, so
+ * that a fault during the copy does not pick it. */
+bool
+page_cache_test_accessed (struct page *page) {
+	struct list_elem *e;
+	bool accessed = false;
+
+	if (!lock_try_acquire (&page_cache_lock))
+		return true;
+	if (page->page_cache.users > 0) {
+		lock_release (&page_cache_lock);
+		return true;
+	}
+	for (e = list_begin (&page->page_cache.mappings);
+			e != list_end (&page->page_cache.mappings); e = list_next (e)) {
+		struct page *mapped = list_entry (e, struct page, file.cache_elem);
+
+		if (pml4_is_accessed (mapped->file.pml4, mapped->va)) {
+			pml4_set_accessed (mapped->file.pml4, mapped->va, false);
+			accessed = true;
+		}
+	}
+	lock_release (&page_cache_lock);
+	return accessed;
+}
+
+/* Returns true if cached PAGE matches its file, so evicting it
+ * needs no writeback.  Like page_cache_test_accessed(), only tries
+ * page_cache_lock; while it is busy PAGE counts as dirty. */
+bool
+page_cache_test_clean (struct page *page) {
+	struct list_elem *e;
+	bool clean;
+
+	if (!lock_try_acquire (&page_cache_lock))
+		return false;
+	clean = !page->page_cache.dirty;
+	for (e = list_begin (&page->page_cache.mappings);
+			clean && e != list_end (&page->page_cache.mappings);
+			e = list_next (e)) {
+		struct page *mapped = list_entry (e, struct page, file.cache_elem);
+
+		clean = !pml4_is_dirty (mapped->file.pml4, mapped->va);
+	}
+	lock_release (&page_cache_lock);
+	return clean;
+}
+
+/* If the page of INODE holding OFS is cached, copies SIZE bytes at
+ * OFS from it into BUFFER and returns true.  The range must not
+ * cross a page boundary.  BUFFER may be a user buffer. */
+bool
+page_cache_read (struct inode *inode, void *buffer, off_t ofs, off_t size) {
+	off_t page_ofs = ofs - ofs % PGSIZE;
+	struct page *cached;
+
+	ASSERT (ofs % PGSIZE + size <= PGSIZE);
+
+	cached = page_cache_get (inode, page_ofs);
+	if (cached == NULL)
+		return false;
+	memcpy (buffer, (uint8_t *) cached->frame->kva + (ofs - page_ofs), size);
+
+	lock_acquire (&page_cache_lock);
+	page_cache_put (cached);
+	lock_release (&page_cache_lock);
+	return true;
+}
+
+/* If the page of INODE holding OFS is cached, copies SIZE bytes
+ * from BUFFER into it at OFS and returns true.  The range must not
+ * cross a page boundary.  BUFFER may be a user buffer. */
+bool
+page_cache_write (struct inode *inode, const void *buffer, off_t ofs,
+		off_t size) {
+	off_t page_ofs = ofs - ofs % PGSIZE;
+	struct page *cached;
+	struct page_cache *pc;
+	size_t end = ofs - page_ofs + size;
+
+	ASSERT (ofs % PGSIZE + size <= PGSIZE);
+
+	cached = page_cache_get (inode, page_ofs);
+	if (cached == NULL)
+		return false;
+	memcpy ((uint8_t *) cached->frame->kva + (ofs - page_ofs), buffer, size);
+
+	lock_acquire (&page_cache_lock);
+	pc = &cached->page_cache;
+	/* 파일 끝을 넘어 쓰면 zero 로 채워 두었던 부분도 파일이 됨 */
+	if (end > pc->read_bytes)
+		pc->read_bytes = end;
+	pc->dirty = true;
+	page_cache_put (cached);
+	lock_release (&page_cache_lock);
+	return true;
 }
 
 /* Utilze the Swap in mechanism to implement readhead */
 static bool
 page_cache_readahead (struct page *page, void *kva) {
+	struct page_cache *pc = &page->page_cache;
+
+	if (inode_read_at (pc->inode, kva, pc->read_bytes, pc->ofs)
+			!= (off_t) pc->read_bytes)
+		return false;
+	memset ((uint8_t *) kva + pc->read_bytes, 0, PGSIZE - pc->read_bytes);
+	return true;
 }
 
 /* Utilze the Swap out mechanism to implement writeback */
+/* 쫓겨나는 page cache page 는 모든 mapping 을 끊고, 더러우면 파일에 쓴 뒤
+   cache 에서 빠진다.  frame 은 evict 한 쪽이 다시 쓰므로 여기서 PAGE 만 해제. */
 static bool
 page_cache_writeback (struct page *page) {
+	lock_acquire (&page_cache_lock);
+	/* 새 복사는 lookup 에서 막히고, 진행 중인 복사만 기다림 */
+	page->page_cache.evicting = true;
+	while (page->page_cache.users > 0)
+		cond_wait (&page_cache_cond, &page_cache_lock);
+	page_cache_unmap_all (page);
+	if (page->page_cache.dirty)
+		page_cache_write_back (page);
+	hash_delete (&page_caches, &page->hash_elem);
+	list_remove (&page->page_cache.elem);
+	/* 기다리던 lookup 은 이제 없음을 보고 buffer cache 로 가거나 다시 읽음 */
+	cond_broadcast (&page_cache_cond, &page_cache_lock);
+	lock_release (&page_cache_lock);
+
+	page->frame = NULL;
+	vm_dealloc_page (page);
+	return true;
 }
 
 /* Destory the page_cache. */
 static void
 page_cache_destroy (struct page *page) {
+	inode_close (page->page_cache.inode);
+}
+
+/* Worker thread for page cache: serves read-ahead requests. */
+static void
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		lock_acquire (&page_cache_lock);
+		while (ra_cnt == 0) {
+			kworker_idle = true;
+			lock_release (&page_cache_lock);
+			sema_down (&kworker_sema);
+			lock_acquire (&page_cache_lock);
+		}
+
+		/* 순차 read-ahead.  미리 읽느라 다른 page 를 쫓아내지는 않음 */
+		while (ra_cnt > 0) {
+			struct inode *inode = ra_queue[ra_head].inode;
+			off_t ofs = ra_queue[ra_head].ofs;
+			bool cached;
+
+			ra_head = (ra_head + 1) % RA_QUEUE_SIZE;
+			ra_cnt--;
+			cached = page_cache_lookup (inode, ofs) != NULL;
+			lock_release (&page_cache_lock);
+
+			if (!cached)
+				page_cache_load (inode, ofs, false);
+			inode_close (inode);
+			lock_acquire (&page_cache_lock);
+		}
+		lock_release (&page_cache_lock);
+	}
+}
+
+/* Writes dirty pages back every PAGE_CACHE_WRITEBACK_TICKS, counted
+   from the previous pass or from when the cache stopped being
+   empty.  Sleeps until then instead of polling. */
+static void
+page_cache_flushd (void *aux UNUSED) {
+	int64_t last_writeback = timer_ticks ();
+
+	for (;;) {
+		int64_t left;
+
+		lock_acquire (&page_cache_lock);
+		while (list_empty (&page_cache_list)) {
+			flushd_idle = true;
+			lock_release (&page_cache_lock);
+			sema_down (&flushd_sema);
+			lock_acquire (&page_cache_lock);
+			last_writeback = timer_ticks ();
+		}
+		lock_release (&page_cache_lock);
+
+		left = last_writeback + PAGE_CACHE_WRITEBACK_TICKS - timer_ticks ();
+		if (left > 0)
+			timer_sleep (left);
+		last_writeback = timer_ticks ();
+		page_cache_sweep ();
+	}
+}
+
+static uint64_t
+page_cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *page = hash_entry (e, struct page, hash_elem);
+
+	return hash_bytes (&page->page_cache.inode, sizeof page->page_cache.inode)
+		^ hash_int (page->page_cache.ofs);
+}
+
+static bool
+page_cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct page_cache *a = &hash_entry (a_, struct page, hash_elem)->page_cache;
+	const struct page_cache *b = &hash_entry (b_, struct page, hash_elem)->page_cache;
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->ofs < b->ofs;
 }
 
-/* Worker thread for page cache */
+/* Returns the cached page of INODE at OFS, or NULL.  If the page
+ * is being evicted, waits until it is gone and returns NULL, so the
+ * caller reads the written-back data instead.  page_cache_lock must
+ * be held; it may be released while waiting. */
+static struct page *
+page_cache_lookup (struct inode *inode, off_t ofs) {
+	struct page key;
+	struct hash_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&page_cache_lock));
+
+	key.page_cache.inode = inode;
+	key.page_cache.ofs = ofs;
+	for (;;) {
+		struct page *page;
+
+		e = hash_find (&page_caches, &key.hash_elem);
+		if (e == NULL)
+			return NULL;
+		page = hash_entry (e, struct page, hash_elem);
+		if (!page->page_cache.evicting)
+			return page;
+		cond_wait (&page_cache_cond, &page_cache_lock);
+	}
+}
+
+/* Returns the cached page of INODE at OFS with its frame held for
+ * a copy, or NULL if it is not cached or is being evicted.  The
+ * frame stays in the cache until page_cache_put(). */
+static struct page *
+page_cache_get (struct inode *inode, off_t ofs) {
+	struct page *page;
+
+	lock_acquire (&page_cache_lock);
+	page = page_cache_lookup (inode, ofs);
+	if (page != NULL)
+		page->page_cache.users++;
+	lock_release (&page_cache_lock);
+	return page;
+}
+
+/* Ends a copy started by page_cache_get().  page_cache_lock must be
+ * held. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_put (struct page *page) {
+	ASSERT (lock_held_by_current_thread (&page_cache_lock));
+	ASSERT (page->page_cache.users > 0);
+
+	if (--page->page_cache.users == 0)
+		cond_broadcast (&page_cache_cond, &page_cache_lock);
+}
+
+/* Reads the page of INODE at OFS into a new frame and adds it to the
+ * cache, unless another thread got there first.  If EVICT is false,
+ * only a free frame is used.  Returns false if no frame was
+ * available or the read failed. */
+static bool
+page_cache_load (struct inode *inode, off_t ofs, bool evict) {
+	struct page *page = malloc (sizeof *page);
+	struct page_cache *pc;
+	off_t length;
+	bool locked;
+
+	if (page == NULL)
+		return false;
+	page_cache_initializer (page, VM_PAGE_CACHE, NULL);
+	page->va = NULL;
+	page->frame = NULL;
+	page->writable = true;
+	pc = &page->page_cache;
+	pc->inode = inode_reopen (inode);
+	pc->ofs = ofs;
+	pc->dirty = false;
+	pc->users = 0;
+	pc->evicting = false;
+	list_init (&pc->mappings);
+
+	/* 읽어서 cache 에 넣을 때까지 inode_write_at() 이 끼어들면
+	   그 내용이 이 page 에도 buffer cache 에도 반영되지 않을 수 있음.
+	   inode_write_at() 이 user buffer 를 복사하다 fault 가 나서 들어온
+	   경우에는 이미 그 lock 을 쥐고 있고, 다른 writer 도 막혀 있음 */
+	locked = !inode_lock_held (inode);
+	if (locked)
+		inode_lock (inode);
+	length = inode_length (inode);
+	pc->read_bytes = ofs >= length ? 0
+		: (length - ofs < PGSIZE ? (size_t) (length - ofs) : PGSIZE);
+	if (!vm_claim_kernel_page (page, evict)) {
+		if (locked)
+			inode_unlock (inode);
+		if (page->frame != NULL)
+			vm_free_frame (page->frame);
+		vm_dealloc_page (page);
+		return false;
+	}
+
+	lock_acquire (&page_cache_lock);
+	if (page_cache_lookup (inode, ofs) != NULL) {
+		lock_release (&page_cache_lock);
+		if (locked)
+			inode_unlock (inode);
+		vm_free_frame (page->frame);
+		vm_dealloc_page (page);
+		return true;
+	}
+	hash_insert (&page_caches, &page->hash_elem);
+	list_push_back (&page_cache_list, &pc->elem);
+	vm_unpin_frame (page->frame);
+	page_cache_wake (&flushd_sema, &flushd_idle);
+	lock_release (&page_cache_lock);
+	if (locked)
+		inode_unlock (inode);
+	return true;
+}
+
+/* Queues a read-ahead of the page of INODE at OFS for kworkerd. */
+static void
+page_cache_request (struct inode *inode, off_t ofs) {
+	lock_acquire (&page_cache_lock);
+	/* lookup 이 lock 을 놓을 수 있으므로 큐 검사는 그 뒤에 */
+	if (page_cache_lookup (inode, ofs) == NULL && ra_cnt < RA_QUEUE_SIZE) {
+		size_t i = (ra_head + ra_cnt++) % RA_QUEUE_SIZE;
+
+		ra_queue[i].inode = inode_reopen (inode);
+		ra_queue[i].ofs = ofs;
+		page_cache_wake (&kworker_sema, &kworker_idle);
+	}
+	lock_release (&page_cache_lock);
+}
+
+/* Wakes the daemon that sleeps on SEMA if *IDLE says it is waiting
+ * for work.  page_cache_lock must be held. */
+static void
+page_cache_wake (struct semaphore *sema, bool *idle) {
+	if (*idle) {
+		*idle = false;
+		sema_up (sema);
+	}
+}
+
+/* Removes every mapping of cached PAGE, noting whether any of them
+ * wrote to it.  page_cache_lock must be held. */
+static void
+page_cache_unmap_all (struct page *page) {
+	struct list *mappings = &page->page_cache.mappings;
+
+	while (!list_empty (mappings)) {
+		struct page *mapped = list_entry (list_pop_front (mappings),
+				struct page, file.cache_elem);
+
+		if (pml4_is_dirty (mapped->file.pml4, mapped->va))
+			page->page_cache.dirty = true;
+		pml4_clear_page (mapped->file.pml4, mapped->va);
+		mapped->file.cache = NULL;
+		mapped->frame = NULL;
+	}
+}
+
+/* Writes cached PAGE back to its file.  page_cache_lock must be
+ * held. */
+static void
+page_cache_write_back (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+	off_t written;
+
+	written = inode_writeback_at (pc->inode, page->frame->kva,
+			pc->read_bytes, pc->ofs);
+	/* inode_write_at() 이 length 를 늘리기 전이면 나머지는 다음 번에 */
+	pc->dirty = written < (off_t) pc->read_bytes;
+}
+
+/* Writes back every page that was written through file_write() or
+ * through one of its mappings since the previous pass. */
+static void
+page_cache_sweep (void) {
+	struct list_elem *e;
+
+	lock_acquire (&page_cache_lock);
+	for (e = list_begin (&page_cache_list); e != list_end (&page_cache_list);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, page_cache.elem);
+		struct page_cache *pc = &page->page_cache;
+		struct list_elem *m;
+
+		for (m = list_begin (&pc->mappings); m != list_end (&pc->mappings);
+				m = list_next (m)) {
+			struct page *mapped = list_entry (m, struct page, file.cache_elem);
+
+			if (pml4_is_dirty (mapped->file.pml4, mapped->va)) {
+				pc->dirty = true;
+				pml4_set_dirty (mapped->file.pml4, mapped->va, false);
+			}
+		}
+		if (pc->dirty)
+			page_cache_write_back (page);
+	}
+	lock_release (&page_cache_lock);
 }
+#endif /* EFILESYS */
@@ -2,7 +2,11 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
@@ -16,6 +20,24 @@ typedef uint32_t disk_sector_t;
  * printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* Most sectors a single disk_request may cover. */
+#define DISK_REQUEST_SECTORS_MAX 128
+
+/* An asynchronous transfer of CNT consecutive sectors.
+   Initialize with disk_request_init(), queue with disk_submit(),
+   and wait for completion with disk_wait().  The request and its
+   buffer must stay alive until then.  The queue reorders
+   requests, so requests in flight must not overlap. */
+struct disk_request {
+	struct disk *disk;          /* Disk to transfer to or from. */
+	disk_sector_t sec_no;       /* First sector. */
+	size_t cnt;                 /* Number of sectors. */
+	void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+	bool write;                 /* Write BUFFER to disk if true. */
+	struct semaphore done;      /* Up'd when the transfer is complete. */
+	struct list_elem elem;      /* Channel queue element. */
+};
+
 void disk_init (void);
 void disk_print_stats (void);
 
@@ -23,6 +45,14 @@ struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multi (struct disk *, disk_sector_t, void *, size_t cnt);
+void disk_write_multi (struct disk *, disk_sector_t, const void *,
+		size_t cnt);
+
+void disk_request_init (struct disk_request *, struct disk *, disk_sector_t,
+		void *buffer, size_t cnt, bool write);
+void disk_submit (struct disk_request *);
+void disk_wait (struct disk_request *);
 
 void 	register_disk_inspect_intr ();
 #endif /* devices/disk.h */
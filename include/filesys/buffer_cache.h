@@ -0,0 +1,29 @@
+#ifndef FILESYS_BUFFER_CACHE_H
+#define FILESYS_BUFFER_CACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+#include "filesys/off_t.h"
+
+/* Sector buffer cache for the file system disk.
+ *
+ * inode.c and fat.c go through this cache instead of calling
+ * disk_read()/disk_write() on filesys_disk directly.  Writes are
+ * kept in the cache (write-behind) and reach the disk when the
+ * entry is evicted, when the periodic flush thread runs, or when
+ * buffer_cache_done() is called at shutdown. */
+
+#define BUFFER_CACHE_SIZE 64            /* Number of cached sectors. */
+#define BUFFER_CACHE_FLUSH_INTERVAL 500 /* Ticks between background flushes. */
+
+void buffer_cache_init (void);
+void buffer_cache_done (void);
+
+void buffer_cache_read (disk_sector_t, void *buffer, off_t sector_ofs,
+		int size);
+void buffer_cache_write (disk_sector_t, const void *buffer, off_t sector_ofs,
+		int size);
+void buffer_cache_readahead (disk_sector_t);
+void buffer_cache_flush_all (void);
+
+#endif /* filesys/buffer_cache.h */
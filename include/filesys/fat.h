@@ -27,6 +27,10 @@ void fat_close (void);
 cluster_t fat_create_chain (
     cluster_t clst /* Cluster # to stretch, 0: Create a new chain */
 );
+cluster_t fat_create_chain_n (
+    cluster_t clst, /* Cluster # to stretch, 0: Create a new chain */
+    size_t cnt      /* Number of clusters to add */
+);
 void fat_remove_chain (
     cluster_t clst, /* Cluster # to be removed */
     cluster_t pclst /* Previous cluster of clst, 0: clst is the start of chain */
@@ -35,6 +39,7 @@ cluster_t fat_get (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
 disk_sector_t cluster_to_sector (cluster_t clst);
 // 추가
+cluster_t sector_to_cluster (disk_sector_t sector);
 
 
 #endif /* filesys/fat.h */
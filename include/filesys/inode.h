@@ -22,6 +22,12 @@ off_t inode_length (const struct inode *);
 
 //------project4-start---------------------------------------------------
 bool inode_is_dir (const struct inode *inode);
+void inode_dir_lock (struct inode *);
+void inode_dir_unlock (struct inode *);
+void inode_lock (struct inode *);
+void inode_unlock (struct inode *);
+bool inode_lock_held (struct inode *);
+off_t inode_writeback_at (struct inode *, const void *, off_t size, off_t offset);
 //------project4-end-----------------------------------------------------
 
 #endif /* filesys/inode.h */
@@ -1,12 +1,43 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
 
 struct page;
+struct inode;
 enum vm_type;
 
-struct page_cache {};
+/* One page of a file, held in a frame from the frame table.
+ *
+ * A page cache page is not in any supplemental page table; its
+ * `hash_elem' links it into the page cache instead.  Every mmap'd
+ * VM_FILE page of the same file offset maps this page's frame
+ * directly, and file_read()/file_write() copy to and from the same
+ * frame, so a file page is never buffered twice. */
+struct page_cache {
+	struct inode *inode;        /* Cached file (reference held). */
+	off_t ofs;                  /* Page-aligned offset in INODE. */
+	size_t read_bytes;          /* Bytes backed by the file, rest is zero. */
+	bool dirty;                 /* Newer than the file on disk. */
+	int users;                  /* Copies to or from the frame under way. */
+	bool evicting;              /* Being written back to be evicted. */
+	struct list mappings;       /* VM_FILE pages mapping this frame. */
+	struct list_elem elem;      /* Element in the page cache list. */
+};
 
-void page_cache_init (void);
+#define PAGE_CACHE_WRITEBACK_TICKS 500   /* Ticks between writebacks. */
+
+void pagecache_init (void);
+void page_cache_done (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+
+bool page_cache_map (struct page *page, struct inode *, off_t ofs);
+void page_cache_unmap (struct page *page);
+bool page_cache_test_accessed (struct page *page);
+bool page_cache_test_clean (struct page *page);
+bool page_cache_read (struct inode *, void *buffer, off_t ofs, off_t size);
+bool page_cache_write (struct inode *, const void *buffer, off_t ofs,
+		off_t size);
 #endif
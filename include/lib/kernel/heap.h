@@ -0,0 +1,68 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue (pairing heap).
+ *
+ * Like the linked list and hash table, this heap does not use
+ * dynamic allocation.  Each structure that can potentially be in
+ * a heap must embed a struct heap_elem member, and the heap_entry
+ * macro converts a struct heap_elem back to the structure object
+ * that contains it.  Refer to lib/kernel/list.h for a detailed
+ * explanation of the technique.
+ *
+ * The "top" of the heap is its least element according to the
+ * heap's LESS function.  Elements that compare equal come out in
+ * the order they were pushed, so a heap can replace a list kept
+ * sorted with list_insert_ordered().
+ *
+ * Costs: heap_push() and heap_top() are O(1); heap_pop(),
+ * heap_remove() and heap_update() are O(log n) amortized. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* Leftmost child. */
+	struct heap_elem *next;     /* Next sibling. */
+	struct heap_elem *prev;     /* Previous sibling, or parent if leftmost. */
+	uint64_t seq;               /* Push order, breaks ties. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A should come out of the
+   heap before B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Least element, or NULL. */
+	size_t elem_cnt;            /* Number of elements in heap. */
+	uint64_t next_seq;          /* Sequence number of next push. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,37 @@
+#ifndef __LIB_KERNEL_LZF_H
+#define __LIB_KERNEL_LZF_H
+
+/* LZF compression.
+ *
+ * A byte-oriented LZ77 codec in the format of Marc Lehmann's
+ * liblzf: fast to compress and very fast to decompress, at a
+ * modest ratio.  The compressed data is a sequence of chunks,
+ * each starting with a control byte CTRL:
+ *
+ *   CTRL < 32:  CTRL + 1 literal bytes follow.
+ *
+ *   CTRL >= 32: a back reference.  LEN = CTRL >> 5 and, if LEN is
+ *               7, the next byte is added to it.  The next byte
+ *               and the low 5 bits of CTRL give OFS; LEN + 2 bytes
+ *               are copied from OFS + 1 bytes before the output
+ *               position.
+ *
+ * Like the other kernel libraries, the codec does no dynamic
+ * allocation: the compressor takes a hash table of LZF_HTAB_SIZE
+ * entries from the caller. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Entries in the compressor's hash table. */
+#define LZF_HTAB_SIZE (1 << 12)
+
+/* Largest input lzf_compress() accepts. */
+#define LZF_MAX_INPUT (UINT16_MAX - 1)
+
+size_t lzf_compress (const void *in, size_t in_len, void *out,
+		size_t out_len, uint16_t htab[LZF_HTAB_SIZE]);
+size_t lzf_decompress (const void *in, size_t in_len, void *out,
+		size_t out_len);
+
+#endif /* lib/kernel/lzf.h */
@@ -0,0 +1,76 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* 17.14 fixed-point real numbers used by the MLFQS scheduler.
+ *
+ * The kernel does not support floating point, so load_avg and
+ * recent_cpu are kept as a signed 32-bit integer whose lowest
+ * FP_SHIFT bits are the fraction.  N denotes an integer and X, Y
+ * denote fixed-point numbers below. */
+typedef int fixed_t;
+
+#define FP_SHIFT 14                 /* Number of fraction bits. */
+#define FP_ONE (1 << FP_SHIFT)      /* Fixed-point 1.0. */
+
+/* 정수 N을 fixed-point로 변환 */
+static inline fixed_t
+int_to_fp (int n) {
+	return n * FP_ONE;
+}
+
+/* X를 정수로 변환 (0 방향으로 버림) */
+static inline int
+fp_to_int (fixed_t x) {
+	return x / FP_ONE;
+}
+
+/* X를 가장 가까운 정수로 반올림 */
+static inline int
+fp_to_int_round (fixed_t x) {
+	return x >= 0 ? (x + FP_ONE / 2) / FP_ONE : (x - FP_ONE / 2) / FP_ONE;
+}
+
+static inline fixed_t
+add_fp (fixed_t x, fixed_t y) {
+	return x + y;
+}
+
+static inline fixed_t
+sub_fp (fixed_t x, fixed_t y) {
+	return x - y;
+}
+
+static inline fixed_t
+add_mixed (fixed_t x, int n) {
+	return x + n * FP_ONE;
+}
+
+static inline fixed_t
+sub_mixed (fixed_t x, int n) {
+	return x - n * FP_ONE;
+}
+
+/* 곱셈, 나눗셈은 중간 결과가 넘치지 않도록 64비트로 계산 */
+static inline fixed_t
+mult_fp (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * y / FP_ONE;
+}
+
+static inline fixed_t
+mult_mixed (fixed_t x, int n) {
+	return x * n;
+}
+
+static inline fixed_t
+div_fp (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * FP_ONE / y;
+}
+
+static inline fixed_t
+div_mixed (fixed_t x, int n) {
+	return x / n;
+}
+
+#endif /* threads/fixed_point.h */
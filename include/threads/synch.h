@@ -2,12 +2,14 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <heap.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,6 +22,7 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct list_elem elem;      /* holder의 held_locks 원소 */
 };
 
 void lock_init (struct lock *);
@@ -28,6 +31,39 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Reader-writer lock.
+   Any number of readers, or a single writer, may hold it at once.
+   Writers go through WRITE_LOCK, an ordinary lock, so threads
+   waiting behind a writer donate their priority to it. */
+struct rwlock {
+	struct lock write_lock;     /* Held by the writer; briefly by readers. */
+	unsigned readers;           /* Number of readers holding the lock. */
+	bool writer_waiting;        /* A writer waits for readers to drain. */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Spinlock.
+   Busy-waits instead of sleeping, so it may be used where a
+   thread cannot block (the scheduler itself, interrupt handlers).
+   Interrupts stay disabled while it is held. */
+struct spinlock {
+	volatile int locked;        /* 1 while held. */
+	int cpu;                    /* APIC ID of the holding CPU, if LOCKED. */
+	enum intr_level old_level;  /* Interrupt level to restore on release. */
+};
+
+void spin_lock_init (struct spinlock *);
+void spin_lock_acquire (struct spinlock *);
+void spin_lock_release (struct spinlock *);
+bool spin_lock_held (const struct spinlock *);
+
 /* Condition variable. */
 struct condition {
 	struct list waiters;        /* List of waiting threads. */
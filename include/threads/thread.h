@@ -6,9 +6,11 @@
 
 #include <debug.h>
 #include <list.h>
+#include <heap.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/fixed_point.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -83,12 +85,12 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an eement in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+ * The `wait_elem' member has a dual purpose.  It can be an
+ * element in the sleep heap (thread.c), or it can be an element
+ * in a semaphore wait heap (synch.c).  It can be used these two
+ * ways only because they are mutually exclusive: a sleeping
+ * thread is blocked in thread_sleep(), not in sema_down(). */
 struct thread
 {
 	/* Owned by thread.c. */
@@ -100,12 +102,18 @@ struct thread
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem; /* List element. */
 	int64_t wakeup_tick;   /* 해당 스레드가 깨어날 시간 */
+	struct heap_elem wait_elem;	   /* sleep heap 또는 semaphore waiters heap 원소 */
+	struct semaphore *wait_on_sema; /* 대기 중인 semaphore (없으면 NULL) */
 	/* for priority donation */
 	int priority;					/* Priority. */
 	int init_priority;				/* donation 이후 우선순위를 초기화하기 위해 초기값 저장 */
 	struct lock *wait_on_lock;		/* 해당 스레드가 대기 하고 있는 lock자료구조의 주소를 저장 */
-	struct list donations;			/* multiple donation 을 고려하기 위해 사용 */
-	struct list_elem donation_elem; /* multiple donation 을 고려하기 위해 사용 */
+	struct list held_locks;			/* 보유 중인 lock 목록, multiple donation 을 고려하기 위해 사용 */
+	/* for mlfqs */
+	int nice;						/* 다른 스레드에게 CPU를 양보하는 정도 */
+	fixed_t recent_cpu;				/* 최근에 사용한 CPU 시간 (fixed-point) */
+	bool ran_in_slot;				/* 이번 4 tick 동안 실행되어 ran_list에 있음 */
+	struct list_elem ran_elem;		/* ran_list element */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -180,15 +188,13 @@ int thread_get_load_avg(void);
 
 void thread_sleep(int64_t ticks);			   /* 실행 중인 스레드를 슬립으로 만듬 */
 void thread_awake(int64_t ticks);			   /* 슬립큐에서 깨워야할 스레드를 깨움 */
-void update_next_tick_to_awake(int64_t ticks); /* 최소 틱을 가진 스레드 저장 */
-int64_t get_next_tick_to_awake(void);		   /* thread.c의 next_tick_to_awake 반환 */
+int64_t get_next_tick_to_awake(void);		   /* sleep heap에서 가장 먼저 깨어날 tick 반환 */
 
 void test_max_priority(void);															   /* 현재 수행중인 스레드와 가장 높은 우선순위의 스레드의 우선순위를 비교하여 스케줄링 */
-bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED); /* 인자로 주어진 스레드들의 우선순위를 비교 */
-bool cmp_don_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
+bool cmp_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED); /* 인자로 주어진 스레드들의 우선순위를 비교 */
 
 void donate_priority(void);
-void remove_with_lock(struct lock *lock); /* lock 을 해지 했을때 donations 리스트에서 해당 엔트리를 삭제 하기 위한 함수 */
+void remove_with_lock(struct lock *lock); /* lock 을 해지 했을때 held_locks 리스트에서 해당 lock을 삭제 하기 위한 함수 */
 void refresh_priority(void);
 
 void do_iret(struct intr_frame *tf);
@@ -2,7 +2,9 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 #include "threads/vaddr.h"  //  추가
+#include "devices/disk.h"
 struct page;
+struct frame;
 enum vm_type;
 
 struct anon_page {
@@ -10,7 +12,22 @@ struct anon_page {
     int swap_location;   // swap disk 위치
 };
 
+/* A swap-out started by anon_swap_out_start(). */
+struct anon_swap_write {
+    struct frame *frame;        /* Frame being evicted. */
+    size_t slot;                /* Slot its pages now point to. */
+    bool write;                 /* SLOT is being filled from FRAME. */
+    bool disk;                  /* ...by REQ, not by zswap. */
+    struct disk_request req;    /* The disk write, if DISK. */
+};
+
+extern const char *swap_disk_list;
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_swap_dup (struct page *page);
+void swap_slot_put (size_t slot);
+void anon_swap_out_start (struct page *page, struct anon_swap_write *);
+void anon_swap_out_finish (struct anon_swap_write *);
 
 #endif
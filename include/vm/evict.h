@@ -0,0 +1,45 @@
+#ifndef VM_EVICT_H
+#define VM_EVICT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+struct page;
+
+/* A page replacement policy.  Every hook is called with the frame
+ * table lock held; hooks other than VICTIM may be null.
+ *
+ * VICTIM returns an unpinned frame in use to evict, or a null
+ * pointer if every frame is pinned.  CLAIMED is called when FRAME
+ * starts holding PAGE (a null PAGE for a page cache page),
+ * EVICTED for each page unmapped from an evicted FRAME, RELEASED
+ * when FRAME goes back to the user pool, and FORGET when a page
+ * that is not resident is destroyed. */
+struct evict_policy {
+	const char *name;
+	void (*init) (void);
+	struct frame *(*victim) (void);
+	void (*claimed) (struct frame *, struct page *);
+	void (*evicted) (struct frame *, struct page *);
+	void (*released) (struct frame *);
+	void (*forget) (struct page *);
+};
+
+/* -evict=NAME: 쓸 policy.  NULL 이면 clock-pro */
+extern const char *evict_policy_name;
+
+void evict_init (void);
+struct frame *evict_victim (void);
+void evict_claimed (struct frame *, struct page *);
+void evict_evicted (struct frame *, struct page *);
+void evict_released (struct frame *);
+void evict_forget (struct page *);
+
+/* The frame table, for the policies (vm.c).  The frame table lock
+ * must be held. */
+size_t vm_frame_cnt (void);
+struct frame *vm_frame_at (size_t idx);
+bool vm_frame_accessed (struct frame *);
+bool vm_frame_clean (struct frame *);
+
+#endif /* vm/evict.h */
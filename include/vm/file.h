@@ -10,9 +10,14 @@ enum vm_type;
 struct file_page {
 	// --------------------project3 Anonymous Page start---------
 	struct file *file;
-	size_t length;
+	size_t length;		// 파일에서 읽어 오는 바이트 수 (page_read_bytes)
 	off_t offset;
 	// --------------------project3 Anonymous Page end---------
+#ifdef EFILESYS
+	struct page *cache;			/* 매핑 중인 page cache page, 없으면 NULL */
+	uint64_t *pml4;				/* 매핑된 page table */
+	struct list_elem cache_elem;	/* page cache 의 mappings 리스트 원소 */
+#endif
 };
 //-------project3-memory_management-end----------------
 
@@ -21,4 +26,7 @@ bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+#ifdef EFILESYS
+bool file_backed_map (struct page *page);
+#endif
 #endif
@@ -0,0 +1,22 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+
+#define KSM_SCAN_TICKS 20       /* Ticks between ksmd passes. */
+#define KSM_SCAN_PAGES 64       /* Frames looked at per pass. */
+
+/* -ksm: ksmd 를 돌림.  기본은 꺼짐 */
+extern bool ksm_enabled;
+
+void ksm_init (void);
+size_t ksm_merged_cnt (void);
+void ksm_print_stats (void);
+
+/* The frame table, for ksmd (vm.c). */
+bool vm_frame_mergeable (struct frame *);
+bool vm_merge_frames (struct frame *keep, struct frame *dup);
+
+#endif /* vm/ksm.h */
@@ -56,6 +56,10 @@ struct page {
 	struct hash_elem hash_elem; 
 
 	//-------project3-memory_management-end----------------
+	uint64_t *pml4;              /* 이 page 를 mapping 하는 page table */
+	struct list_elem frame_elem; /* frame 의 pages 리스트 원소 */
+	bool in_test;                /* 쫓겨났지만 clock-pro 가 기억하는 중 */
+	struct list_elem test_elem;  /* clock-pro 의 test_pages 원소 */
 	
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -79,11 +83,18 @@ struct page {
 };
 
 /* The representation of "frame" */
-// 물리적 메모리를 나타냄
+// 물리적 메모리를 나타냄.  user pool 의 page 마다 하나씩 frame table 배열에 있음
 struct frame {
 	void *kva; // 커널 가상 주소: 물리메모리 프레임이랑 일대일로 매핑되어 있는 가상 주소
 	struct page *page; // 페이지 구조
-	struct list_elem frame_elem; // 
+	struct list pages; // 이 frame 을 mapping 한 page 들. fork 후에는 COW 로 여럿이 공유
+	int refcnt;        // pages 의 원소 수
+	int swap_slot;     // 같은 내용이 있는 swap slot, 없으면 -1.  쓰이면 낡음
+	bool dirty;        // 다시 쓴 PTE 에서 옮겨 둔 dirty bit
+	bool used;         // user pool 에서 받아 쓰는 중
+	bool pinned; // 채우거나 내보내는 중이라 victim 으로 고르면 안 됨
+	bool hot;    // clock-pro: 자주 쓰여 cold hand 가 쫓아내지 않음
+	bool test;   // clock-pro: cold 인데 test 기간 중 (다시 쓰이면 hot)
 };
 
 /* The function table for page operations.
@@ -132,6 +143,14 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_claim_kernel_page (struct page *page, bool evict);
+struct frame *vm_claim_free_frame (struct page *page);
+void vm_free_frame (struct frame *frame);
+void vm_unpin_frame (struct frame *frame);
+bool vm_release_frame (struct page *page);
+bool vm_zero_mapped (struct page *page);
+size_t vm_unmap_frame (struct frame *frame,
+		void (*unmapped) (struct page *, void *aux), void *aux);
 enum vm_type page_get_type (struct page *page);
 
 bool
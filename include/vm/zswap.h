@@ -0,0 +1,22 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Values of a zswap handle other than a stored page. */
+#define ZSWAP_NONE -1   /* Not stored: incompressible, or zswap is off. */
+#define ZSWAP_ZERO -2   /* A page of zeros, which takes no space. */
+#define ZSWAP_FULL -3   /* Not stored: the arena is full. */
+
+/* -zswap=PAGES: arena 의 최대 page 수.  -1 이면 user pool 의 1/8, 0 이면 끔 */
+extern int zswap_pages;
+
+void zswap_init (void);
+size_t zswap_capacity (void);
+int zswap_store (const void *page, size_t slot);
+void zswap_load (int handle, void *page);
+void zswap_free (int handle);
+bool zswap_victim (size_t *slot);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */
@@ -0,0 +1,207 @@
+/* Pairing heap.
+
+   See heap.h for basic information.
+
+   Each node keeps its children as a doubly linked sibling list
+   headed by `child'.  The leftmost child's `prev' points back to
+   its parent, which is what lets heap_remove() cut an arbitrary
+   node out of the tree in O(1) before re-merging its children. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static bool before (const struct heap *, const struct heap_elem *,
+		const struct heap_elem *);
+static struct heap_elem *link (struct heap *, struct heap_elem *,
+		struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+static void insert (struct heap *, struct heap_elem *);
+
+/* Initializes heap H as empty, ordered by LESS given auxiliary
+   data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->next_seq = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into heap H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->seq = h->next_seq++;
+	insert (h, e);
+	h->elem_cnt++;
+}
+
+/* Returns the least element of H without removing it.
+   H must not be empty. */
+struct heap_elem *
+heap_top (struct heap *h) {
+	ASSERT (!heap_empty (h));
+	return h->root;
+}
+
+/* Removes and returns the least element of H.
+   H must not be empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top;
+
+	ASSERT (!heap_empty (h));
+
+	top = h->root;
+	h->root = merge_pairs (h, top->child);
+	top->child = NULL;
+	h->elem_cnt--;
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *sub;
+
+	ASSERT (!heap_empty (h));
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		heap_pop (h);
+		return;
+	}
+
+	cut (e);
+	sub = merge_pairs (h, e->child);
+	e->child = NULL;
+	if (sub != NULL)
+		h->root = link (h, h->root, sub);
+	h->elem_cnt--;
+}
+
+/* Restores the heap property after the key of E, which must be
+   in H, has changed in either direction.  E keeps its original
+   push order relative to equal elements. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	uint64_t seq = e->seq;
+
+	heap_remove (h, e);
+	e->seq = seq;
+	insert (h, e);
+	h->elem_cnt++;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (struct heap *h) {
+	return h->root == NULL;
+}
+
+/* Returns true if A must come out of H before B: A is less than
+   B, or they are equal and A was pushed first. */
+static bool
+before (const struct heap *h, const struct heap_elem *a,
+		const struct heap_elem *b) {
+	if (h->less (a, b, h->aux))
+		return true;
+	if (h->less (b, a, h->aux))
+		return false;
+	return a->seq < b->seq;
+}
+
+/* Merges the two trees rooted at A and B and returns the root
+   of the result.  A and B must not have siblings. */
+static struct heap_elem *
+link (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	if (before (h, b, a)) {
+		struct heap_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* B becomes the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Merges the sibling list starting at FIRST into a single tree
+   and returns its root, or NULL if FIRST is NULL.  Uses the
+   standard two-pass scheme: link siblings pairwise from left to
+   right, then link the results from right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* First pass.  The linked pairs are stacked through `next'. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+		struct heap_elem *m;
+
+		if (b != NULL) {
+			first = b->next;
+			a->prev = a->next = NULL;
+			b->prev = b->next = NULL;
+			m = link (h, a, b);
+		} else {
+			first = NULL;
+			a->prev = a->next = NULL;
+			m = a;
+		}
+		m->next = pairs;
+		pairs = m;
+	}
+
+	/* Second pass. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = root != NULL ? link (h, pairs, root) : pairs;
+		pairs = next;
+	}
+	return root;
+}
+
+/* Detaches the subtree rooted at E, which must not be a root,
+   from its parent and siblings. */
+static void
+cut (struct heap_elem *e) {
+	ASSERT (e->prev != NULL);
+
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->prev = e->next = NULL;
+}
+
+/* Links E into H as a single-node tree, keeping E's sequence
+   number. */
+static void
+insert (struct heap *h, struct heap_elem *e) {
+	e->child = e->next = e->prev = NULL;
+	h->root = h->root != NULL ? link (h, h->root, e) : e;
+}
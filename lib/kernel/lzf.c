@@ -0,0 +1,156 @@
+#include "lzf.h"
+#include <string.h>
+#include "../debug.h"
+
+/* LZF compression.
+
+   See lzf.h for the format.  The compressor hashes the three
+   bytes at each input position and keeps, per hash, the last
+   position seen (plus one, so that zero means empty).  A position
+   whose three bytes match the remembered one starts a back
+   reference, which is then extended as far as it matches. */
+
+#define MAX_LIT (1 << 5)                /* Longest literal run. */
+#define MAX_OFF (1 << 13)               /* Farthest back reference. */
+#define MAX_REF ((1 << 8) + (1 << 3))   /* Longest back reference. */
+
+/* Returns the hash of the three bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p) {
+	uint32_t v = (uint32_t) p[0] << 16 | (uint32_t) p[1] << 8 | p[2];
+
+	return (v * 2654435761u) >> (32 - 12) & (LZF_HTAB_SIZE - 1);
+}
+
+/* Compresses the IN_LEN bytes at IN into the OUT_LEN bytes at OUT,
+   using HTAB as scratch space.  Returns the compressed size, or 0
+   if it would not fit in OUT_LEN bytes.  IN_LEN must not exceed
+   LZF_MAX_INPUT. */
+size_t
+lzf_compress (const void *in_, size_t in_len, void *out_, size_t out_len,
+		uint16_t htab[LZF_HTAB_SIZE]) {
+	const uint8_t *in = in_;
+	const uint8_t *ip = in;
+	const uint8_t *in_end = in + in_len;
+	uint8_t *out = out_;
+	uint8_t *op = out;
+	uint8_t *out_end = out + out_len;
+	uint8_t *run;           /* Control byte of the current literal run. */
+	size_t lit = 0;         /* Bytes in the current literal run. */
+
+	ASSERT (in_len <= LZF_MAX_INPUT);
+
+	if (in_len == 0 || out_len < 2)
+		return 0;
+	memset (htab, 0, LZF_HTAB_SIZE * sizeof *htab);
+
+	run = op++;
+	while (ip < in_end) {
+		const uint8_t *ref = NULL;
+		size_t off = 0;
+
+		if (in_end - ip >= 3) {
+			unsigned h = hash3 (ip);
+
+			if (htab[h] != 0) {
+				ref = in + htab[h] - 1;
+				off = ip - ref - 1;
+			}
+			htab[h] = ip - in + 1;
+		}
+
+		if (ref != NULL && off < MAX_OFF
+				&& ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2]) {
+			size_t max = in_end - ip < MAX_REF ? in_end - ip : MAX_REF;
+			size_t len = 3, i;
+
+			while (len < max && ref[len] == ip[len])
+				len++;
+
+			/* Up to 3 bytes of reference and the next run's control byte. */
+			if (out_end - op < 4)
+				return 0;
+			if (lit > 0)
+				*run = lit - 1;
+			else
+				op = run;
+			if (len - 2 < 7)
+				*op++ = (len - 2) << 5 | off >> 8;
+			else {
+				*op++ = 7 << 5 | off >> 8;
+				*op++ = len - 2 - 7;
+			}
+			*op++ = off;
+
+			/* Remember the positions inside the match, too. */
+			for (i = 1; i < len && in_end - (ip + i) >= 3; i++)
+				htab[hash3 (ip + i)] = ip + i - in + 1;
+			ip += len;
+			run = op++;
+			lit = 0;
+		} else {
+			if (op >= out_end)
+				return 0;
+			*op++ = *ip++;
+			if (++lit == MAX_LIT) {
+				*run = MAX_LIT - 1;
+				if (op >= out_end)
+					return 0;
+				run = op++;
+				lit = 0;
+			}
+		}
+	}
+
+	if (lit > 0)
+		*run = lit - 1;
+	else
+		op = run;
+	return op - out;
+}
+
+/* Decompresses the IN_LEN bytes at IN into the OUT_LEN bytes at
+   OUT.  Returns the decompressed size, or 0 if IN is corrupt or
+   would not fit in OUT_LEN bytes. */
+size_t
+lzf_decompress (const void *in_, size_t in_len, void *out_, size_t out_len) {
+	const uint8_t *ip = in_;
+	const uint8_t *in_end = ip + in_len;
+	uint8_t *out = out_;
+	uint8_t *op = out;
+	uint8_t *out_end = out + out_len;
+
+	while (ip < in_end) {
+		unsigned ctrl = *ip++;
+
+		if (ctrl < MAX_LIT) {
+			size_t len = ctrl + 1;
+
+			if ((size_t) (in_end - ip) < len || (size_t) (out_end - op) < len)
+				return 0;
+			memcpy (op, ip, len);
+			ip += len;
+			op += len;
+		} else {
+			size_t len = ctrl >> 5;
+			size_t off;
+
+			if (len == 7) {
+				if (ip >= in_end)
+					return 0;
+				len += *ip++;
+			}
+			if (ip >= in_end)
+				return 0;
+			off = ((ctrl & 0x1f) << 8 | *ip++) + 1;
+			len += 2;
+			if (off > (size_t) (op - out) || (size_t) (out_end - op) < len)
+				return 0;
+
+			/* 겹칠 수 있으므로 한 byte 씩 */
+			for (; len > 0; len--, op++)
+				*op = op[-off];
+		}
+	}
+	return op - out;
+}
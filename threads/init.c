@@ -31,6 +31,9 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/evict.h"
+#include "vm/zswap.h"
+#include "vm/ksm.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -234,6 +237,16 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-swap"))
+			swap_disk_list = value;
+		else if (!strcmp (name, "-evict"))
+			evict_policy_name = value;
+		else if (!strcmp (name, "-zswap"))
+			zswap_pages = atoi (value);
+		else if (!strcmp (name, "-ksm"))
+			ksm_enabled = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -336,6 +349,12 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -swap=C:D[,C:D...] Stripe swap over disks hdC:D (default 1:1).\n"
+			"  -evict=POLICY      Page replacement: clock-pro (default) or clock.\n"
+			"  -zswap=PAGES       Compress swapped pages in up to PAGES kernel pages.\n"
+			"  -ksm               Merge identical anonymous pages in the background.\n"
 #endif
 			);
 	power_off ();
@@ -370,4 +389,8 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	zswap_print_stats ();
+	ksm_print_stats ();
+#endif
 }
@@ -47,14 +47,14 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, cmp_priority, NULL);
 }
 
 /* One semaphore in a list. */
 struct semaphore_elem {
 	struct list_elem elem;              /* List element. */
 	struct semaphore semaphore;         /* This semaphore. */
-	int sema_priority;
+	struct thread *thread;              /* 이 semaphore에서 기다리는 스레드 */
 };
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -76,8 +76,9 @@ sema_down (struct semaphore *sema) {
 	old_level = intr_disable ();
 
 	while (sema->value == 0) {
-		list_insert_ordered (&sema->waiters, &thread_current()->elem,
-		cmp_priority, NULL);
+		/* 우선순위 heap에 넣어 두면 sema_up 때 정렬 없이 가장 높은 스레드를 꺼낼 수 있음 */
+		thread_current ()->wait_on_sema = sema;
+		heap_push (&sema->waiters, &thread_current ()->wait_elem);
 		thread_block ();	// context switching
 	}
 	sema->value--;
@@ -90,9 +91,8 @@ void *aux UNUSED){
 	struct semaphore_elem *sa = list_entry(a, struct semaphore_elem, elem);
 	struct semaphore_elem *sb = list_entry(b, struct semaphore_elem, elem);
 
-	/* 해당 condition variable 을 기다리는 세마포어 리스트를
-	가장 높은 우선순위를 가지는 스레드의 우선순위 순으로 정렬하도록 구현 */
-	if (sa->sema_priority > sb->sema_priority){
+	/* 기다리는 스레드의 지금 우선순위로 비교 (기다리는 동안 donation 받았을 수 있음) */
+	if (sa->thread->priority > sb->thread->priority){
 		return true;
 	}else{
 		return false;
@@ -137,11 +137,12 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
-		/* 스레드가 waiters list에 있는 동안 우선순위가 변경 되었을 경우를 
-		고려 하여 waiters list 를 우선순위로 정렬 */
-		list_sort(&sema->waiters, cmp_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters), struct thread, elem));
+	if (!heap_empty (&sema->waiters)){
+		/* 기다리는 동안 우선순위가 바뀐 스레드는 thread_change_priority()가
+		heap 안에서 위치를 고쳐 두므로 top이 항상 가장 높은 우선순위 */
+		struct thread *t = heap_entry (heap_pop (&sema->waiters), struct thread, wait_elem);
+		t->wait_on_sema = NULL;
+		thread_unblock (t);
 	}
 	sema->value++;
 	/* 우선순위에 따라 선점이 발생하도록 */
@@ -224,17 +225,18 @@ lock_acquire (struct lock *lock) {
 	struct thread *cur = thread_current();
 	/* 해당 lock 의 holder가 존재 한다면 아래 작업을 수행 */
 	/* 현재 스레드의 wait_on_lock 변수에 획득 하기를 기다리는 lock의 주소를 저장 */ 
-	if(lock->holder != NULL){
+	/* mlfqs 에서는 priority donation 을 하지 않음 */
+	if(lock->holder != NULL && !thread_mlfqs){
 		cur->wait_on_lock = lock;
-		/* donation 을 받은 스레드의 thread 구조체를 list로 관리 */
-		list_insert_ordered(&lock->holder->donations, &cur->donation_elem, cmp_don_priority ,NULL);
-		/* priority donation 수행하기 위해 donate_priority() 함수 호출 */
+		/* priority donation 수행하기 위해 donate_priority() 함수 호출.
+		   이후 holder가 받는 donation은 lock의 waiters heap top으로 계산됨 */
 		donate_priority();
 	}
 	sema_down (&lock->semaphore);
 	cur->wait_on_lock = NULL;
 	/* lock을 획득 한 후 lock holder 를 갱신한다. */
 	lock->holder = thread_current();
+	list_push_back (&cur->held_locks, &lock->elem);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -251,8 +253,10 @@ lock_try_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+		list_push_back (&thread_current ()->held_locks, &lock->elem);
+	}
 	return success;
 }
 
@@ -269,10 +273,11 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	/* lock 을 해지 했을때 donations 리스트에서 해당 엔트리를 삭제 하기 위한 함수 */
+	/* lock 을 해지 했을때 held_locks 리스트에서 해당 lock을 삭제 하기 위한 함수 */
 	remove_with_lock(lock);
 	/* 스레드의 우선순위가 변경 되었을때 donation 을 고려하여 우선순위를 다시 결정 하는 함수 */
-	refresh_priority();
+	if (!thread_mlfqs)
+		refresh_priority();
 	lock->holder = NULL;
 	sema_up (&lock->semaphore);
 }
@@ -287,6 +292,157 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
+/* Initializes reader-writer lock RW as unheld. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->write_lock);
+	rw->readers = 0;
+	rw->writer_waiting = false;
+	sema_init (&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  Readers pass through WRITE_LOCK, so a
+   reader that has to wait donates its priority to the writer,
+   and a waiting writer keeps new readers out. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->write_lock);
+	old_level = intr_disable ();
+	rw->readers++;
+	intr_set_level (old_level);
+	lock_release (&rw->write_lock);
+}
+
+/* Releases RW, which the current thread holds for reading.
+   The last reader out wakes a writer waiting to get in. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (rw->readers > 0);
+	if (--rw->readers == 0 && rw->writer_waiting) {
+		rw->writer_waiting = false;
+		sema_up (&rw->drained);
+	}
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until the current writer
+   and all readers have left.  Threads that wait for RW while we
+   hold it donate their priority to us, as with a lock. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->write_lock);
+
+	/* No new reader can get in now; wait for the current ones. */
+	old_level = intr_disable ();
+	if (rw->readers > 0) {
+		rw->writer_waiting = true;
+		sema_down (&rw->drained);
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_for_write (rw));
+
+	lock_release (&rw->write_lock);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return lock_held_by_current_thread (&rw->write_lock) && rw->readers == 0;
+}
+
+/* Initializes spinlock LOCK as unheld. */
+void
+spin_lock_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	lock->locked = 0;
+	lock->cpu = -1;
+	lock->old_level = INTR_OFF;
+}
+
+/* Returns the initial APIC ID of the CPU running the caller
+   (CPUID leaf 1, EBX bits 31:24).  Unlike the running thread, it
+   stays the same across a context switch, which matters for
+   sched_lock: it is taken by the thread switching out and
+   released by the one switching in. */
+static int
+this_cpu (void) {
+	uint32_t eax = 1, ebx, ecx = 0, edx;
+
+	asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	return ebx >> 24;
+}
+
+/* Acquires spinlock LOCK, busy-waiting until it is free.
+   Interrupts are disabled first and stay disabled until the
+   matching spin_lock_release(), so a holder can never be
+   preempted or interrupted by code that wants the same lock.
+   Spinlocks are not recursive: acquiring one that the caller
+   already holds never returns.
+
+   This function may be called within an interrupt handler. */
+void
+spin_lock_acquire (struct spinlock *lock) {
+	enum intr_level old_level;
+
+	ASSERT (lock != NULL);
+
+	old_level = intr_disable ();
+	while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (lock->locked)
+			asm volatile ("pause");
+	lock->cpu = this_cpu ();
+	lock->old_level = old_level;
+}
+
+/* Releases spinlock LOCK and restores the interrupt level that
+   was in effect when it was acquired. */
+void
+spin_lock_release (struct spinlock *lock) {
+	enum intr_level old_level;
+
+	ASSERT (lock != NULL);
+	ASSERT (spin_lock_held (lock));
+
+	old_level = lock->old_level;
+	lock->cpu = -1;
+	__atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+	intr_set_level (old_level);
+}
+
+/* Returns true if the CPU running the caller holds LOCK. */
+bool
+spin_lock_held (const struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	return lock->locked != 0 && lock->cpu == this_cpu ();
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -329,9 +485,8 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	/* condition variable의 waiters list에 우선순위 순서로 삽입되도록 수정 */
-	waiter.sema_priority = thread_get_priority();
-	list_insert_ordered (&cond->waiters, &waiter.elem, cmp_sem_priority, NULL); 
+	waiter.thread = thread_current ();
+	list_push_back (&cond->waiters, &waiter.elem);
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -352,11 +507,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		 /* condition variable의 waiters list를 우선순위로 재정렬 */
-		list_sort(&cond->waiters, cmp_sem_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	if (!list_empty (&cond->waiters)) {
+		/* 정렬하지 않고 가장 높은 우선순위의 waiter 하나만 찾음 (같으면 먼저 온 것) */
+		struct list_elem *e = list_min (&cond->waiters, cmp_sem_priority, NULL);
+		list_remove (e);
+		sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+	}
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -10,6 +10,8 @@
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/fixed_point.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,13 +26,44 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-static struct list sleep_list;
-
-int64_t next_tick_to_awake = INT64_MAX;
+/* Scheduler lock.  Protects the run queues, the sleep heap,
+   all_list, destruction_req, thread_ticks and load_avg below.  On
+   this uniprocessor kernel it amounts to disabling interrupts, but
+   taking it explicitly marks every piece of shared scheduler state,
+   which is what must hold before more than one CPU can run the
+   scheduler.
+
+   A thread that gives up the CPU takes sched_lock before it puts
+   itself on a queue or changes its status, and keeps it through
+   the switch; the thread switched to releases it in
+   schedule_tail().  So no other CPU can pick a thread that is
+   still running on its old stack. */
+static struct spinlock sched_lock;
+
+/* Run queues of processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running.  There is one FIFO
+   queue per priority level, and bit N of ready_bitmap is set exactly
+   when ready_queues[N] is non-empty, so both enqueue and picking the
+   highest priority thread are O(1). */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt;			/* ready queue에 있는 스레드 수 */
+
+/* List of all processes.  Processes are added to this list
+   when they are created and removed when they exit.
+   Only walked by the once-per-second MLFQS update. */
+static struct list all_list;
+
+/* Threads that were switched to since the last 4-tick priority
+   recompute, linked through ran_elem.  Only they (and the running
+   thread) can have had their recent_cpu bumped in that time. */
+static struct list ran_list;
+
+/* Sleeping threads, kept in a pairing heap ordered by wakeup_tick
+   and linked through wait_elem.  Insertion is O(1) and each wakeup
+   costs O(log n) amortized, so timer_interrupt() only does work
+   for the threads that actually wake up. */
+static struct heap sleep_heap;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -58,6 +91,14 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* MLFQS */
+#define NICE_MIN -20
+#define NICE_DEFAULT 0
+#define NICE_MAX 20
+#define RECENT_CPU_DEFAULT 0
+#define LOAD_AVG_DEFAULT 0
+static fixed_t load_avg;		/* 최근 1분 동안 실행 가능한 스레드의 평균 개수 */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -65,7 +106,18 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
+static void schedule_tail (void);
 static tid_t allocate_tid (void);
+static void thread_change_priority (struct thread *, int priority);
+static bool cmp_wakeup_tick (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static int ready_queue_max_priority (void);
+static void mlfqs_tick (void);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *);
+static void mlfqs_update_load_avg (void);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -111,9 +163,16 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	spin_lock_init (&sched_lock);
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init (&ready_queues[pri]);
+	ready_bitmap = 0;
+	ready_cnt = 0;
+	list_init (&all_list);
 	list_init (&destruction_req);
-	list_init (&sleep_list);
+	list_init (&ran_list);
+	load_avg = LOAD_AVG_DEFAULT;
+	heap_init (&sleep_heap, cmp_wakeup_tick, NULL);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
@@ -161,9 +220,14 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
+	if (thread_mlfqs)
+		mlfqs_tick ();
+
 	/* 선점 시행 */
+	spin_lock_acquire (&sched_lock);
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
+	spin_lock_release (&sched_lock);
 }
 
 /* Prints thread statistics. */
@@ -204,6 +268,15 @@ thread_create (const char *name, int priority,
 	/* Initialize thread. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
+
+	/* mlfqs에서는 부모의 nice, recent_cpu를 물려받고 우선순위는 직접 계산 */
+	t->nice = thread_current ()->nice;
+	t->recent_cpu = thread_current ()->recent_cpu;
+	if (thread_mlfqs && function != idle) {
+		spin_lock_acquire (&sched_lock);
+		mlfqs_update_priority (t);
+		spin_lock_release (&sched_lock);
+	}
 	//------project4-start---------------------------------------------------
 	#ifdef EFILESYS
 	if(thread_current()->cur_dir != NULL) {
@@ -251,8 +324,8 @@ void
 thread_block (void) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
-	thread_current()->status = THREAD_BLOCKED;
-	schedule ();
+	spin_lock_acquire (&sched_lock);
+	do_schedule (THREAD_BLOCKED);
 }
 
 /* Transitions a blocked thread T to the ready-to-run state.
@@ -263,18 +336,16 @@ thread_block (void) {
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
    update other data. */
-/* 해당 thread를 우선순위 정렬하여 ready list에 넣고 status도 ready로 옮겨줌 */
+/* 해당 thread를 우선순위별 ready queue 뒤에 넣고 status도 ready로 옮겨줌 */
 void
 thread_unblock (struct thread *t) {
-	enum intr_level old_level;
-
 	ASSERT (is_thread (t));
 
-	old_level = intr_disable ();
+	spin_lock_acquire (&sched_lock);
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
+	ready_queue_push (t);
 	t->status = THREAD_READY;
-	intr_set_level (old_level);
+	spin_lock_release (&sched_lock);
 }
 
 /* Returns the name of the running thread. */
@@ -319,7 +390,10 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
-	// list_remove(&thread_current()->allelem);
+	spin_lock_acquire (&sched_lock);
+	list_remove(&thread_current()->allelem);
+	if (thread_current ()->ran_in_slot)
+		list_remove (&thread_current ()->ran_elem);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -335,28 +409,35 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();		 /* interrupt 비활성화 */
+	/* 다른 CPU가 queue에서 curr를 꺼내 가지 못하도록 switch가 끝날 때까지 쥠 */
+	spin_lock_acquire (&sched_lock);
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, cmp_priority, NULL); /* 현재 thread가 CPU를 양보하여 ready_list에 삽입 될 때 
-	우선순위 순서로 정렬되어 삽입 되도록 수정 */
+		ready_queue_push (curr);		/* 현재 thread가 CPU를 양보하여 자기 우선순위 queue의 맨 뒤에 삽입 */
 	do_schedule (THREAD_READY);			/* running thread 를 ready로 바꾸고 다음 thread를 running으로 바꿈 : 컨텍스트 스위치 작업을 수행 */
 	intr_set_level (old_level);			/* interrupt 못받는 상태로 설정하고, 이전 인터럽트 상태 반환 */
 }
 
-/* next_tick_to_awake가 깨워야 할 스레드 중 가장 작은 tick을 갖도록 업데이트 */
- void update_next_tick_to_awake(int64_t ticks) { // ticks = 최소값 
-	if (next_tick_to_awake > ticks){
-		next_tick_to_awake = ticks;
-	}
+/* sleep heap 정렬 기준: 깨어날 시간이 더 이른 스레드가 먼저 */
+static bool
+cmp_wakeup_tick (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, wait_elem)->wakeup_tick
+		< heap_entry (b, struct thread, wait_elem)->wakeup_tick;
 }
 
-
-/* next_tick_to_awake 을 반환. */ 
+/* 가장 먼저 깨어나야 할 스레드의 tick을 반환. 자는 스레드가 없으면 INT64_MAX. */
 int64_t get_next_tick_to_awake(void) {
-	return next_tick_to_awake;
+	int64_t next_tick;
+
+	spin_lock_acquire (&sched_lock);
+	next_tick = heap_empty (&sleep_heap) ? INT64_MAX
+		: heap_entry (heap_top (&sleep_heap), struct thread, wait_elem)->wakeup_tick;
+	spin_lock_release (&sched_lock);
+	return next_tick;
 }
 
 
-/* Thread를 blocked 상태로 만들고 sleep queue에 삽입하여 대기 */
+/* Thread를 blocked 상태로 만들고 sleep heap에 삽입하여 대기 */
 void
 thread_sleep(int64_t ticks){ 				/* ticks = 현재 시간 + 재울 시간 = 깨어날 시간 */ 
 	struct thread *curr = thread_current(); /* 현재 쓰레드 */
@@ -367,54 +448,114 @@ thread_sleep(int64_t ticks){ 				/* ticks = 현재 시간 + 재울 시간 = 깨
 	old_level = intr_disable ();			/* 인터럽트를 사용하지 않도록 설정하고 이전 인터럽트 상태를 반환  */
 	
 	curr->wakeup_tick = ticks;				/* 현재 쓰레드의 wakeup_tick에 ticks 저장*/
-	if (curr != idle_thread){				/* idle_thread는 sleep list에 넣지 않음 */
-		list_push_back (&sleep_list, &curr->elem);
-		update_next_tick_to_awake(ticks);	/* awake함수가 실행되어야 할 tick값을 update */
+	if (curr != idle_thread){				/* idle_thread는 sleep heap에 넣지 않음 */
+		spin_lock_acquire (&sched_lock);
+		heap_push (&sleep_heap, &curr->wait_elem);	/* O(1) 삽입 */
 		do_schedule (THREAD_BLOCKED);		/* running thread 를 block으로 바꾸고 다음 thread를 running으로 바꿈 : 컨텍스트 스위치 작업을 수행 */
 	}
 	intr_set_level (old_level);				/* 인터럽트를 다시 받아들이도록 수정 */
 }
 
 
-/* Sleep queue에서 깨워야 할 thread를 찾아서 wake */
+/* Sleep heap에서 깨워야 할 thread만 꺼내서 wake */
 void thread_awake(int64_t ticks){ 			/* ticks = 현재 시간 */
-	int64_t next_tick_to_awake = INT64_MAX; /* 쓰레드가 일어나면 sleep list 변할 거라 최소 시간 갱신 */
-	/* sleep list의 모든 entry 를 순회 */
-	struct list_elem *cur = list_begin(&sleep_list);
-	while(cur != list_end(&sleep_list)){
-		struct thread *t = list_entry(cur, struct thread, elem); /* cur의 structure 포인터 반환 */
-		if (ticks >= t->wakeup_tick){	/* 현재 시간이 t의 wakeup_tick보다 크거나 같으면 */
-			/* 슬립 큐에서 제거하고 unblock */
-			cur = list_remove(&t->elem);
-			thread_unblock(t);
-		}else{	/* 현재 시간이 t의 wakeup_tick보다 작으면 update_next_tick_to_awake()를 호출 */ 
-			update_next_tick_to_awake(t->wakeup_tick);	/* 최소 틱을 next_tick_to_awak에 update */
-			cur = list_next(cur);						/* cur를 다음 cur로 변경 */
+	/* root가 가장 이른 wakeup_tick을 가지므로 깨울 스레드가 없으면 바로 멈춤 */
+	for (;;) {
+		struct thread *t = NULL;
+
+		spin_lock_acquire (&sched_lock);
+		if (!heap_empty (&sleep_heap)) {
+			t = heap_entry (heap_top (&sleep_heap), struct thread, wait_elem);
+			if (ticks >= t->wakeup_tick)
+				heap_pop (&sleep_heap);
+			else
+				t = NULL;
 		}
+		spin_lock_release (&sched_lock);
+
+		if (t == NULL)
+			break;
+		thread_unblock (t);
 	}
 }
 
 
-/* ready_list에서 우선순위가 가장 높은 스레드와 현재 스레드의 우선순위를 비교하여 스케줄링 */
+/* ready queue에서 우선순위가 가장 높은 스레드와 현재 스레드의 우선순위를 비교하여 스케줄링 */
 void test_max_priority (void){
 	struct thread *curr = thread_current ();
-	if(!intr_context() && !list_empty(&ready_list)){	/* ready_list 가 비어있지 않은지 확인 : 비어있으면 error */
-		struct list_elem *high = list_begin(&ready_list);	/* ready list에서 우선순위 제일 높은 것 */
-		struct thread *t = list_entry(high, struct thread, elem); /* high의 structure 포인터 반환 */
-		if(t->priority > curr->priority){	/* ready list에서 제일 높은 우선순위가 현재 스레드보다 높다면 */
-			thread_yield();					/*무조건 run thread 재우고 ready list 우선순위 높은 thread 실행 */
-		}
-	}else{
+	bool preempt = false;
+
+	if(intr_context())
 		return;
-	} 
+	spin_lock_acquire (&sched_lock);
+	if(ready_bitmap != 0)	/* ready queue 가 비어있지 않은지 확인 */
+		preempt = ready_queue_max_priority() > curr->priority;	/* ready queue에서 제일 높은 우선순위가 현재 스레드보다 높다면 */
+	spin_lock_release (&sched_lock);
+	if(preempt)
+		thread_yield();					/*무조건 run thread 재우고 ready queue 우선순위 높은 thread 실행 */
+}
+
+/* T를 T의 우선순위에 해당하는 ready queue 맨 뒤에 넣는다.
+   sched_lock을 잡고 호출해야 함. */
+static void
+ready_queue_push (struct thread *t) {
+	ASSERT (spin_lock_held (&sched_lock));
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back (&ready_queues[t->priority], &t->elem);
+	ready_bitmap |= 1ULL << t->priority;
+	ready_cnt++;
+}
+
+/* READY 상태인 T를 자신의 ready queue에서 뺀다.
+   sched_lock을 잡고 호출해야 함. */
+static void
+ready_queue_remove (struct thread *t) {
+	ASSERT (spin_lock_held (&sched_lock));
+	ASSERT (t->status == THREAD_READY);
+
+	list_remove (&t->elem);
+	if (list_empty (&ready_queues[t->priority]))
+		ready_bitmap &= ~(1ULL << t->priority);
+	ready_cnt--;
+}
+
+/* 비어있지 않은 ready queue 중 가장 높은 우선순위.
+   ready_bitmap의 최상위 set bit를 찾는 것으로 끝난다. */
+static int
+ready_queue_max_priority (void) {
+	ASSERT (spin_lock_held (&sched_lock));
+	ASSERT (ready_bitmap != 0);
+	return 63 - __builtin_clzll (ready_bitmap);
+}
+
+/* T의 우선순위를 PRIORITY로 바꾼다.  T가 ready queue에 있다면
+   새 우선순위의 queue로 옮기고, semaphore에서 기다리는 중이면 waiters heap
+   안에서 위치를 고쳐서 next_thread_to_run()과 sema_up()이 바로 반영하도록 한다.
+   sched_lock을 잡고 호출해야 함. */
+static void
+thread_change_priority (struct thread *t, int priority) {
+	ASSERT (spin_lock_held (&sched_lock));
+
+	if (t->priority == priority)
+		return;
+	if (t->status == THREAD_READY) {
+		ready_queue_remove (t);
+		t->priority = priority;
+		ready_queue_push (t);
+	} else {
+		t->priority = priority;
+		if (t->status == THREAD_BLOCKED && t->wait_on_sema != NULL)
+			heap_update (&t->wait_on_sema->waiters, &t->wait_elem);
+	}
 }
 
 
 /* 인자로 주어진 스레드들의 우선순위를 비교 */
-bool cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED){
-	/* list_insert_ordered() 함수에서 사용 하기 위해 정열 방법을 결정하기 위한 함수 작성 */
-	struct thread *cmp_a = list_entry(a, struct thread, elem);
-	struct thread *cmp_b = list_entry(b, struct thread, elem);     
+bool cmp_priority (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED){
+	/* semaphore waiters heap 에서 사용 하기 위해 정열 방법을 결정하기 위한 함수 작성 */
+	struct thread *cmp_a = heap_entry(a, struct thread, wait_elem);
+	struct thread *cmp_b = heap_entry(b, struct thread, wait_elem);
 
 	if(cmp_a->priority > cmp_b->priority){	// a thread가 우선순위가 높으면 1 반환 
 		return true;
@@ -423,15 +564,13 @@ bool cmp_priority (const struct list_elem *a, const struct list_elem *b, void *a
 	}
 }
 
-/* 인자로 주어진 스레드의 donation_elem의 우선순위를 비교 */
-bool cmp_don_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED){
-	return list_entry(a, struct thread, donation_elem)->priority > list_entry(b,struct thread, donation_elem)->priority;
-}
-
 /* Sets the current thread's priority to NEW_PRIORITY. */
 /* 현재 스레드의 우선 순위를 인자로 받은 NEW_PRIORITY로 설정 */
 void
 thread_set_priority (int new_priority) {
+	/* mlfqs에서는 우선순위를 스케줄러가 계산하므로 무시 */
+	if (thread_mlfqs)
+		return;
 	thread_current()->init_priority = new_priority;
 	refresh_priority();		/* 우선순위를 변경으로 인한 donation 관련 정보를 갱신*/
 	test_max_priority();	/* 우선순위에 따라 선점이 발생하도록 */
@@ -455,24 +594,19 @@ void donate_priority(void){
 	while(donated_elem->wait_on_lock != NULL && nested_depth < 8 ){	/* (Nested donation 그림 참고, nested depth 는 8로 제한한다. ) */
 		donated_elem = donated_elem->wait_on_lock->holder;
 		if (donated_elem->priority < cur->priority){
-			donated_elem->priority = cur->priority;
+			spin_lock_acquire (&sched_lock);
+			thread_change_priority (donated_elem, cur->priority);
+			spin_lock_release (&sched_lock);
 			nested_depth ++;
 		}
 	} 
 }
 
 
-/* lock 을 해지 했을때 donations 리스트에서 해당 엔트리를 삭제 하기 위한 함수 */
+/* lock 을 해지 했을때 held_locks 리스트에서 해당 lock을 삭제 하기 위한 함수.
+   그 lock을 기다리던 스레드들의 donation은 lock과 함께 빠짐 */
 void remove_with_lock(struct lock *lock){
-	struct thread *cur = thread_current();
-	struct list_elem *e;
-
-	for (e=list_begin(&cur->donations); e!=list_end(&cur->donations); e=list_next(e)){
-		struct thread *t = list_entry(e, struct thread, donation_elem); /* elme -> donation_elem 으로 체인지 후 pass tests/threads/priority-donate-one*/
-		if(t->wait_on_lock == lock){		/* 해지할 lock을 보유하고 있으면 */
-			list_remove(&t->donation_elem);		/* 보유하고 있는 엔트리를 삭제 - list_remove dont do that 해결 */ 
-		}
-	}
+	list_remove(&lock->elem);
 }
 
 
@@ -480,48 +614,153 @@ void remove_with_lock(struct lock *lock){
 void refresh_priority(void){
 	/* 현재 스레드의 우선순위를 기부받기 전의 우선순위로 변경 */
 	struct thread *cur = thread_current();
-	cur->priority = cur->init_priority;
-
-	/* 가장 우선순위가 높은 donations 리스트의 스레드와
-	현재 스레드의 우선순위를 비교하여 높은 값을 현재 스레드의 우선순위로 설정 */
-	if(list_empty(&cur->donations)== false){
-
-		list_sort(&cur->donations, cmp_don_priority, NULL);
-		struct thread *t = list_entry(list_front(&cur->donations), struct thread, donation_elem);
-
-		/* 가장 우선순위가 높은 donations 리스트의 스레드가 현재 스레드의 우선순위보다 높으면*/
-		if(t->priority > cur->priority){
-			cur->priority = t->priority;
+	struct list_elem *e;
+	int priority = cur->init_priority;
+
+	/* 보유 중인 각 lock 의 waiters heap top 이 그 lock 으로 받는 donation 중
+	가장 높은 것이므로, 정렬 없이 보유한 lock 수 만큼만 보면 됨 */
+	spin_lock_acquire (&sched_lock);
+	for (e = list_begin(&cur->held_locks); e != list_end(&cur->held_locks); e = list_next(e)){
+		struct lock *l = list_entry(e, struct lock, elem);
+		if (!heap_empty(&l->semaphore.waiters)){
+			struct thread *t = heap_entry(heap_top(&l->semaphore.waiters), struct thread, wait_elem);
+			if (t->priority > priority)
+				priority = t->priority;
 		}
-	} 
+	}
+	thread_change_priority (cur, priority);
+	spin_lock_release (&sched_lock);
 }
 
 
 /* Sets the current thread's nice value to NICE. */
+/* 현재 스레드의 nice를 바꾸고 우선순위를 다시 계산, 필요하면 양보 */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+	spin_lock_acquire (&sched_lock);
+	thread_current ()->nice = nice;
+	if (thread_mlfqs)
+		mlfqs_update_priority (thread_current ());
+	spin_lock_release (&sched_lock);
+	test_max_priority ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	int load_avg_100;
+
+	spin_lock_acquire (&sched_lock);
+	load_avg_100 = fp_to_int_round (mult_mixed (load_avg, 100));
+	spin_lock_release (&sched_lock);
+	return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	int recent_cpu_100;
+
+	spin_lock_acquire (&sched_lock);
+	recent_cpu_100 = fp_to_int_round (mult_mixed (thread_current ()->recent_cpu, 100));
+	spin_lock_release (&sched_lock);
+	return recent_cpu_100;
+}
+
+/* priority = PRI_MAX - (recent_cpu / 4) - (nice * 2), PRI_MIN..PRI_MAX로 자름.
+   T가 ready queue에 있으면 새 우선순위의 queue로 옮겨짐.
+   아래 mlfqs_* 함수들은 모두 sched_lock을 잡고 호출해야 함. */
+static void
+mlfqs_update_priority (struct thread *t) {
+	int priority;
+
+	if (t == idle_thread)
+		return;
+	priority = fp_to_int (sub_mixed (sub_fp (int_to_fp (PRI_MAX),
+			div_mixed (t->recent_cpu, 4)), t->nice * 2));
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	t->init_priority = priority;
+	thread_change_priority (t, priority);
+}
+
+/* recent_cpu = (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice */
+static void
+mlfqs_update_recent_cpu (struct thread *t) {
+	fixed_t twice_load, coef;
+
+	if (t == idle_thread)
+		return;
+	twice_load = mult_mixed (load_avg, 2);
+	coef = div_fp (twice_load, add_mixed (twice_load, 1));
+	t->recent_cpu = add_mixed (mult_fp (coef, t->recent_cpu), t->nice);
+}
+
+/* load_avg = (59/60) * load_avg + (1/60) * ready_threads
+   ready_threads는 ready queue의 스레드 수 + 실행 중인 스레드(idle 제외).
+   ready_cnt를 유지하고 있으므로 O(1). */
+static void
+mlfqs_update_load_avg (void) {
+	int ready_threads = ready_cnt;
+
+	if (thread_current () != idle_thread)
+		ready_threads++;
+	load_avg = add_fp (mult_fp (div_fp (int_to_fp (59), int_to_fp (60)), load_avg),
+			mult_mixed (div_fp (int_to_fp (1), int_to_fp (60)), ready_threads));
+}
+
+/* Timer interrupt 마다 호출되는 mlfqs 처리.
+   매 tick 마다 실행 중인 스레드의 recent_cpu만 1 증가시키고,
+   4 tick 마다 그 사이에 실행된 스레드(ran_list)와 지금 스레드의
+   우선순위만 다시 계산한다.  실행되지 않은 스레드들의 recent_cpu와
+   nice는 그 사이에 바뀌지 않으므로 우선순위도 그대로이고,
+   모든 스레드를 도는 것은 1초에 한 번 load_avg를 갱신할 때뿐이다. */
+static void
+mlfqs_tick (void) {
+	struct thread *curr = thread_current ();
+	int64_t ticks = timer_ticks ();
+
+	ASSERT (intr_context ());
+
+	spin_lock_acquire (&sched_lock);
+	if (curr != idle_thread)
+		curr->recent_cpu = add_mixed (curr->recent_cpu, 1);
+
+	if (ticks % TIMER_FREQ == 0) {
+		struct list_elem *e;
+
+		mlfqs_update_load_avg ();
+		for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, allelem);
+			mlfqs_update_recent_cpu (t);
+			mlfqs_update_priority (t);
+		}
+	} else if (ticks % TIME_SLICE == 0) {
+		struct list_elem *e;
+
+		for (e = list_begin (&ran_list); e != list_end (&ran_list); e = list_next (e))
+			mlfqs_update_priority (list_entry (e, struct thread, ran_elem));
+		mlfqs_update_priority (curr);
+	}
+	if (ticks % TIME_SLICE == 0)
+		while (!list_empty (&ran_list))
+			list_entry (list_pop_front (&ran_list), struct thread, ran_elem)
+				->ran_in_slot = false;
+
+	/* 우선순위가 바뀌어서 더 높은 ready 스레드가 생겼으면 양보 */
+	if (ready_bitmap != 0 && ready_queue_max_priority () > curr->priority)
+		intr_yield_on_return ();
+	spin_lock_release (&sched_lock);
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -574,6 +813,7 @@ static void
 kernel_thread (thread_func *function, void *aux) {
 	ASSERT (function != NULL);
 
+	schedule_tail ();     /* switch 해 준 스레드가 잡은 sched_lock을 풂 */
 	intr_enable ();       /* 스케줄러가 인터럽트를 끈 상태에서 실행. */
 	function (aux);       /* 스레드 함수 실행. */
 	thread_exit ();       /* 함수가 반환되면 thread kill */
@@ -593,12 +833,19 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
-	// list_push_back (&all_list, &t->allelem);			/*악깡버*/
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = RECENT_CPU_DEFAULT;
+
+	/* timer interrupt 에서 all_list를 순회하므로 sched_lock을 잡고 추가 */
+	spin_lock_acquire (&sched_lock);
+	list_push_back (&all_list, &t->allelem);
+	spin_lock_release (&sched_lock);
 
 	/* Priority donation 관련 자료구조 초기화 */
 	t->init_priority = priority;
 	t->wait_on_lock = NULL;
-	list_init (&t->donations);
+	list_init (&t->held_locks);
+	t->wait_on_sema = NULL;
 	
 	list_init (&t->childs);				/* 자식 리스트 초기화 */
 	sema_init(&t->fork_sema, 0); /* fork 세마포어 0으로 초기화 */ 
@@ -612,13 +859,19 @@ init_thread (struct thread *t, const char *name, int priority) {
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.  sched_lock must be held. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct thread *t = idle_thread;
+
+	ASSERT (spin_lock_held (&sched_lock));
+
+	if (ready_bitmap != 0) {
+		struct list *queue = &ready_queues[ready_queue_max_priority ()];
+		t = list_entry (list_front (queue), struct thread, elem);
+		ready_queue_remove (t);
+	}
+	return t;
 }
 
 /* Use iretq to launch the thread */
@@ -718,19 +971,16 @@ thread_launch (struct thread *th) {
 			);
 }
 
-/* Schedules a new process. At entry, interrupts must be off.
- * This function modify current thread's status to status and then
- * finds another thread to run and switches to it.
+/* Schedules a new process. At entry, interrupts must be off and
+ * sched_lock must be held.  This function modify current thread's
+ * status to status and then finds another thread to run and
+ * switches to it.  sched_lock is released by the time it returns.
  * It's not safe to call printf() in the schedule(). */
 static void
 do_schedule(int status) {
 	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (spin_lock_held (&sched_lock));
 	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
-		struct thread *victim =
-			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
 	thread_current ()->status = status;
 	schedule ();
 }
@@ -741,6 +991,7 @@ schedule (void) {
 	struct thread *next = next_thread_to_run (); // ready list가 비어있으면 idle_thread 반환
 
 	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (spin_lock_held (&sched_lock));
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
 	/* Mark us as running. */
@@ -749,6 +1000,12 @@ schedule (void) {
 	/* Start new time slice. */
 	thread_ticks = 0;
 
+	/* 다음 4 tick 경계에서 우선순위를 다시 계산할 스레드로 기록 */
+	if (thread_mlfqs && next != idle_thread && !next->ran_in_slot) {
+		next->ran_in_slot = true;
+		list_push_back (&ran_list, &next->ran_elem);
+	}
+
 #ifdef USERPROG
 	/* Activate the new address space. */
 	process_activate (next);
@@ -760,8 +1017,8 @@ schedule (void) {
 		   pull out the rug under itself.
 		   We just queuing the page free reqeust here because the page is
 		   currently used bye the stack.
-		   The real destruction logic will be called at the beginning of the
-		   schedule(). */
+		   The real destruction logic will be called by the next thread,
+		   in schedule_tail(). */
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
 			ASSERT (curr != next);
 			list_push_back (&destruction_req, &curr->elem);
@@ -771,6 +1028,28 @@ schedule (void) {
 		 * of current running. */
 		thread_launch (next);
 	}
+	schedule_tail ();
+}
+
+/* Finishes a switch on the side of the thread switched to: frees
+   the threads that died before the switch and releases sched_lock,
+   which the previous thread took before switching.  Interrupts stay
+   off. */
+static void
+schedule_tail (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (spin_lock_held (&sched_lock));
+
+	while (!list_empty (&destruction_req)) {
+		struct thread *victim =
+			list_entry (list_pop_front (&destruction_req), struct thread, elem);
+
+		/* palloc은 sleep할 수 있는 lock을 쓰므로 sched_lock 없이 해제 */
+		spin_lock_release (&sched_lock);
+		palloc_free_page (victim);
+		spin_lock_acquire (&sched_lock);
+	}
+	spin_lock_release (&sched_lock);
 }
 
 /* Returns a tid to use for a new thread. */
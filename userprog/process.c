@@ -906,6 +906,16 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+		// 파일에서 읽을 것이 없는 page (BSS) 는 0 으로 시작하는 anon page:
+		// 읽기만 하는 동안은 zero frame 을 공유
+		if (page_read_bytes == 0) {
+			if (!vm_alloc_page(VM_ANON, upage, writable))
+				return false;
+			zero_bytes -= page_zero_bytes;
+			upage += PGSIZE;
+			continue;
+		}
+
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
 		struct container *container = (struct container *)malloc(sizeof(struct container));
 		container->file = file;
@@ -50,8 +50,6 @@ bool readdir(int fd, char *name);
 int inumber(int fd);
 int symlink(const char *target, const char *linkpath);
 // ------------project4 - Subdirectories and Soft Links end------------
-struct lock filesys_lock;
-
 
 /* System call.
  *
@@ -77,7 +75,6 @@ void syscall_init(void)
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			  FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-	lock_init(&filesys_lock);
 }
 
 /* 주소 값이 유저 영역에서 사용하는 주소 값인지 확인 하는 함수
@@ -287,9 +284,7 @@ int open(const char *file)
 {
 	/* 성공 시 fd를 생성하고 반환, 실패 시 -1 반환 */
 	check_address(file);
-	lock_acquire(&filesys_lock);
 	struct file *open_file = filesys_open(file);
-	lock_release(&filesys_lock);
 	if (open_file == NULL)
 	{
 		return -1;
@@ -323,9 +318,7 @@ int write(int fd, const void *buffer, unsigned size)
 	}
 	else
 	{
-		lock_acquire(&filesys_lock);
 		int bytes_written = file_write(file, buffer, size);
-		lock_release(&filesys_lock);
 		return bytes_written;
 	}
 }
@@ -422,9 +415,7 @@ int read(int fd, void *buffer, unsigned size)
 	else
 	{
 		// 정상일 때 file_read
-		lock_acquire(&filesys_lock);
 		read_size = file_read(file, buffer, size); // 실제 읽은 사이즈 return
-		lock_release(&filesys_lock);
 	}
 	return read_size;
 }
@@ -592,9 +583,7 @@ bool chdir(const char *dir)
 // 상대 혹은 절대 디렉토리 이름이 dir인 디렉토리를 생성
 bool mkdir(const char *dir)
 {
-	lock_acquire(&filesys_lock);
     bool new_dir = filesys_create_dir(dir);
-    lock_release(&filesys_lock);
     return new_dir;
 }
 
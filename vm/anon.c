@@ -1,9 +1,13 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <stdio.h>
 #include "devices/disk.h"
 #include "lib/kernel/bitmap.h"
+#include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/synch.h"
+#include "vm/zswap.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -11,6 +15,58 @@ static struct disk *swap_disk;
 struct bitmap* swap_table;
 size_t swap_size;
 //-------project3-swap in out end----------------
+
+/* fork 후 COW 로 공유되던 frame 이 쫓겨나면 그 page 들이 한 slot 을
+   함께 쓴다.  swap in 한 frame 도 내용이 바뀌기 전까지 slot 을 쥐고
+   있다가 다시 쫓겨날 때 쓰지 않고 그 slot 을 쓴다 (frame->swap_slot).
+   swap_slots[slot].refs 는 그 slot 을 가리키는 page 와 frame 수이고,
+   0 이 되면 swap_table 에서 비운다.  swap_writing 은 아직 쓰는 중인
+   slot: 그 page 의 주인은 이미 fault 를 낼 수 있으므로 swap in 은
+   쓰기가 끝날 때까지 기다린다.  swap_lock 이 이들과 swap_cursor 를 보호.
+   내용이 zswap 에 있는 slot 은 zswap handle 을 가지며, disk 의 자리는
+   zswap 이 가득 찼을 때 내려보낼 곳으로 비워 둔다 */
+struct swap_slot {
+	unsigned refs;              /* Pages and frames holding the slot. */
+	uint64_t *pml4;             /* Address space of the page written to */
+	void *va;                   /* the slot, and its address. */
+	int zswap;                  /* zswap handle, or ZSWAP_NONE if on disk. */
+};
+static struct swap_slot *swap_slots;
+static struct bitmap *swap_writing;
+/* 다음 slot 을 찾기 시작할 곳 (next-fit).  연달아 쫓겨나는 page 는
+   이어진 slot 에 들어가고, swap in 할 때 SWAP_CLUSTER 단위로 함께 읽힌다 */
+static size_t swap_cursor;
+#define SWAP_CLUSTER 8
+static struct lock swap_lock;
+static struct condition swap_cond;
+
+/* -swap=CHAN:DEV[,CHAN:DEV...]: swap 로 쓸 disk 목록.  NULL 이면 hd1:1 */
+const char *swap_disk_list;
+
+/* Swap slots are striped round-robin over SWAP_DISKS: slot S lives
+   on disk S % swap_disk_cnt, at page S / swap_disk_cnt of that
+   disk, so consecutive slots land on different disks and, when
+   those are on different channels, their transfers overlap.
+   swap_disk is swap_disks[0]. */
+#define SWAP_DISK_MAX 4
+static struct disk *swap_disks[SWAP_DISK_MAX];
+static size_t swap_disk_cnt;
+
+/* One slot read by anon_swap_in(). */
+struct swap_read {
+	struct page *page;
+	struct frame *frame;
+	size_t slot;
+	struct disk_request req;
+};
+
+static void swap_add_disk (int chan_no, int dev_no);
+static struct disk *swap_slot_locate (size_t slot, disk_sector_t *sector);
+static size_t swap_slot_alloc (void);
+static void swap_slot_free (size_t slot);
+static void swap_writeback (void);
+static size_t swap_read_around (size_t slot, struct swap_read *reads);
+static void anon_unmapped (struct page *page, void *w_);
 static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
@@ -28,14 +84,83 @@ void
 vm_anon_init (void) { // 익명 페이지 하위 시스템을 초기화
 	/* TODO: Set up the swap_disk. */
 	//-------project3-swap in out start----------------
-	// 1. swap disk를 셋업.
-	swap_disk = disk_get(1,1);
+	// 1. swap disk를 셋업.  "1:1,1:0" 처럼 CHAN:DEV 를 쉼표로 나열
+	const char *p = swap_disk_list != NULL ? swap_disk_list : "1:1";
+	disk_sector_t min_size = 0;
+	size_t i;
+
+	while (*p != '\0') {
+		if (p[0] < '0' || p[0] > '9' || p[1] != ':' || (p[2] != '0' && p[2] != '1')
+				|| (p[3] != ',' && p[3] != '\0'))
+			PANIC ("bad -swap option `%s' (use CHAN:DEV[,CHAN:DEV...])",
+					swap_disk_list);
+		swap_add_disk (p[0] - '0', p[2] - '0');
+		p += p[3] == ',' ? 4 : 3;
+	}
+	swap_disk = swap_disks[0];
+	zswap_init ();
+
+	// 모든 disk 에 같은 수의 slot 을 두어야 round-robin 이 됨: 가장 작은 disk 기준
+	for (i = 0; i < swap_disk_cnt; i++)
+		if (i == 0 || disk_size(swap_disks[i]) < min_size)
+			min_size = disk_size(swap_disks[i]);
 	// swap_size: page의 개수 = slot의 개수, disk_size(swap_disk): sector의 개수	
-	swap_size = disk_size(swap_disk)/8; // SECTORS_PER_PAGE;	// 1page = 1slot = 8sector
+	swap_size = min_size / SECTORS_PER_PAGE * swap_disk_cnt;	// 1page = 1slot = 8sector
+	// disk 가 없으면 zswap 만 쓰는 slot 들: arena 가 담을 수 있는 만큼에
+	// 자리를 차지하지 않는 zero page 몫을 같은 수만큼 더함
+	if (swap_disk_cnt == 0) {
+		swap_size = 2 * zswap_capacity();
+		printf ("swap: no disk, %zu slots in zswap only\n", swap_size);
+	}
 	swap_table = bitmap_create(swap_size);  // swap_table을 bitmap자료구조로 만듬.
+	swap_writing = bitmap_create(swap_size);
+	swap_slots = calloc(swap_size, sizeof *swap_slots);
+	if (swap_table == NULL || swap_writing == NULL
+			|| (swap_size > 0 && swap_slots == NULL))
+		PANIC ("swap: out of memory for the swap table");
+	lock_init (&swap_lock);
+	cond_init (&swap_cond);
 	//-------project3-swap in out end----------------
 }
 
+/* Adds disk DEV_NO of channel CHAN_NO to the swap stripe.  Disks
+   that are missing, already added, or hold the kernel or the file
+   system are skipped with a message. */
+static void
+swap_add_disk (int chan_no, int dev_no) {
+	struct disk *d = disk_get (chan_no, dev_no);
+	size_t i;
+
+	if (chan_no == 0) {
+		printf ("swap: hd0:%d holds the kernel or file system, skipped\n",
+				dev_no);
+		return;
+	}
+	if (d == NULL) {
+		printf ("swap: hd%d:%d not present, skipped\n", chan_no, dev_no);
+		return;
+	}
+	for (i = 0; i < swap_disk_cnt; i++)
+		if (swap_disks[i] == d)
+			return;
+	if (swap_disk_cnt == SWAP_DISK_MAX) {
+		printf ("swap: more than %d disks, hd%d:%d skipped\n", SWAP_DISK_MAX,
+				chan_no, dev_no);
+		return;
+	}
+	swap_disks[swap_disk_cnt++] = d;
+}
+
+/* Returns the disk that holds swap slot SLOT and stores the first
+   sector of the slot on that disk in *SECTOR. */
+static struct disk *
+swap_slot_locate (size_t slot, disk_sector_t *sector) {
+	ASSERT (slot < swap_size);
+
+	*sector = slot / swap_disk_cnt * SECTORS_PER_PAGE;
+	return swap_disks[slot % swap_disk_cnt];
+}
+
 /* Initialize the file mapping */
 bool
 anon_initializer (struct page *page, enum vm_type type, void *kva) { 
@@ -49,59 +174,329 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	//-------project3-swap in out end----------------
 	page->operations = &anon_ops;
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_location = -1;	// 아직 swap 에 없음
 
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Drops one reference to swap slot SLOT, freeing it when the last
+   page or frame that held it has gone and it is not being
+   written. */
+void
+swap_slot_put (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (swap_slots[slot].refs > 0);
+	if (--swap_slots[slot].refs == 0 && !bitmap_test (swap_writing, slot))
+		swap_slot_free (slot);
+	lock_release (&swap_lock);
+}
+
+/* Frees SLOT and what zswap holds for it.  swap_lock must be
+   held. */
+static void
+swap_slot_free (size_t slot) {
+	ASSERT (lock_held_by_current_thread (&swap_lock));
+
+	if (swap_slots[slot].zswap != ZSWAP_NONE) {
+		zswap_free (swap_slots[slot].zswap);
+		swap_slots[slot].zswap = ZSWAP_NONE;
+	}
+	bitmap_reset (swap_table, slot);
+}
+
+/* Makes PAGE, a copy of a swapped-out page made by fork, share its
+   swap slot. */
+void
+anon_swap_dup (struct page *page) {
+	lock_acquire (&swap_lock);
+	swap_slots[page->anon.swap_location].refs++;
+	lock_release (&swap_lock);
+}
+
+/* Swap in the page by read contents from the swap disk.  Other
+   pages of the current process in the same SWAP_CLUSTER slots are
+   read along with it, into free frames only.  A page zswap holds is
+   decompressed instead, and the frame does not keep the slot. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	//printf("================anon_swap_in 직전\n");
 	struct anon_page *anon_page = &page->anon;
 	//-------project3-swap in out start----------------
 	int bitmap_idx = anon_page->swap_location;
+	struct swap_read *reads;
+	size_t cnt, i;
+	bool zswapped = false;
 
-	if(bitmap_test(swap_table, bitmap_idx) == false) {
+	if(bitmap_idx < 0 || bitmap_test(swap_table, bitmap_idx) == false) {
 		return false;	// bitmap에 false로 표시되었다면, 읽을 수 없으므로 종료
 	}
-	// swap area(disk)에서 frame으로(kva통해서) read하기 
-	for (int i=0; i<SECTORS_PER_PAGE; i++) {
-		disk_read(swap_disk, bitmap_idx*SECTORS_PER_PAGE + i, kva + DISK_SECTOR_SIZE*i);
+	// 내보내는 중이던 slot 이면 다 쓸 때까지 기다림
+	ASSERT(page->frame != NULL && page->frame->swap_slot == -1);
+	lock_acquire(&swap_lock);
+	while (bitmap_test(swap_writing, bitmap_idx))
+		cond_wait(&swap_cond, &swap_lock);
+	if (swap_slots[bitmap_idx].zswap != ZSWAP_NONE) {
+		zswap_load(swap_slots[bitmap_idx].zswap, kva);
+		zswapped = true;
+	}
+	lock_release(&swap_lock);
+	if (zswapped) {
+		// 다시 쫓겨나면 새로 압축하는 편이 arena 를 아낀다
+		anon_page->swap_location = -1;
+		swap_slot_put(bitmap_idx);
+		return true;
+	}
+
+	reads = malloc(SWAP_CLUSTER * sizeof *reads);
+	if (reads == NULL) {
+		// swap area(disk)에서 frame으로(kva통해서) read하기, 8 sector 를 명령 하나로
+		disk_sector_t sector;
+		struct disk *disk = swap_slot_locate(bitmap_idx, &sector);
+		disk_read_multi(disk, sector, kva, SECTORS_PER_PAGE);
+		anon_page->swap_location = -1;
+		page->frame->swap_slot = bitmap_idx;
+		return true;
 	}
 
-	// swap table 업데이트
-	bitmap_set(swap_table, bitmap_idx, false);	// bitmap을 다시 false로 세팅
-	// bitmap_flip(swap_table, bitmap_idx);
+	reads[0].page = page;
+	reads[0].frame = page->frame;
+	reads[0].slot = bitmap_idx;
+	cnt = 1 + swap_read_around(bitmap_idx, reads + 1);
 
+	// 한꺼번에 disk queue 에 넣어 이웃한 sector 끼리 합쳐지게 함
+	for (i = 0; i < cnt; i++) {
+		disk_sector_t sector;
+		struct disk *disk = swap_slot_locate(reads[i].slot, &sector);
+
+		disk_request_init(&reads[i].req, disk, sector, reads[i].frame->kva,
+				SECTORS_PER_PAGE, false);
+		disk_submit(&reads[i].req);
+	}
+	for (i = 0; i < cnt; i++) {
+		disk_wait(&reads[i].req);
+		// page 가 쥐던 slot 은 frame 이 넘겨받음: 쓰이기 전에 쫓겨나면 다시 쓰지 않는다
+		reads[i].page->anon.swap_location = -1;
+		reads[i].frame->swap_slot = reads[i].slot;
+		if (i > 0)
+			vm_unpin_frame(reads[i].frame);
+	}
+	free(reads);
 	return true;
 	//-------project3-swap in out end----------------
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Claims free frames for the other pages of the current process
+   that were swapped out to the SWAP_CLUSTER-slot cluster holding
+   SLOT, and fills in READS for them with the frames pinned.
+   Never evicts.  Returns the number of entries filled in. */
+static size_t
+swap_read_around (size_t slot, struct swap_read *reads) {
+	struct thread *curr = thread_current ();
+	size_t first = slot / SWAP_CLUSTER * SWAP_CLUSTER;
+	size_t s, cnt = 0;
+
+	for (s = first; s < first + SWAP_CLUSTER && s < swap_size; s++) {
+		struct page *page;
+		struct frame *frame;
+		void *va = NULL;
+
+		if (s == slot)
+			continue;
+		lock_acquire (&swap_lock);
+		if (bitmap_test (swap_table, s) && !bitmap_test (swap_writing, s)
+				&& swap_slots[s].zswap == ZSWAP_NONE
+				&& swap_slots[s].pml4 == curr->pml4)
+			va = swap_slots[s].va;
+		lock_release (&swap_lock);
+		if (va == NULL)
+			continue;
+
+		// slot 이 다른 page 에 다시 쓰였을 수 있으니 page 쪽에서 확인
+		page = spt_find_page (&curr->spt, va);
+		if (page == NULL || VM_TYPE (page->operations->type) != VM_ANON
+				|| page->frame != NULL || page->anon.swap_location != (int) s)
+			continue;
+		frame = vm_claim_free_frame (page);
+		if (frame == NULL)
+			break;
+		reads[cnt].page = page;
+		reads[cnt].frame = frame;
+		reads[cnt].slot = s;
+		cnt++;
+	}
+	return cnt;
+}
+
+/* Allocates a free slot for writing, searching next-fit from
+   swap_cursor so that pages evicted one after another get
+   consecutive slots.  Returns BITMAP_ERROR if swap is full.
+   swap_lock must be held. */
+static size_t
+swap_slot_alloc (void) {
+	size_t slot;
+
+	ASSERT (lock_held_by_current_thread (&swap_lock));
+
+	slot = bitmap_scan_and_flip (swap_table, swap_cursor, 1, false);
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	if (slot != BITMAP_ERROR) {
+		swap_cursor = (slot + 1) % swap_size;
+		bitmap_mark (swap_writing, slot);
+		swap_slots[slot].zswap = ZSWAP_NONE;
+	}
+	return slot;
+}
+
+/* Makes room in zswap by writing one page it holds to that page's
+   swap slot on disk.  The slot is marked as being written
+   meanwhile, so swap_in() waits for it.  Does nothing if there is
+   no swap disk. */
+static void
+swap_writeback (void) {
+	size_t slot;
+	disk_sector_t sector;
+	struct disk *disk;
+	void *buf;
+
+	if (swap_disk_cnt == 0)
+		return;
+	buf = palloc_get_page (0);
+	if (buf == NULL)
+		return;
+	lock_acquire (&swap_lock);
+	// 고른 뒤 해제됐거나 다른 곳으로 갔을 수 있음
+	if (!zswap_victim (&slot) || !bitmap_test (swap_table, slot)
+			|| bitmap_test (swap_writing, slot)
+			|| swap_slots[slot].zswap == ZSWAP_NONE) {
+		lock_release (&swap_lock);
+		palloc_free_page (buf);
+		return;
+	}
+	zswap_load (swap_slots[slot].zswap, buf);
+	zswap_free (swap_slots[slot].zswap);
+	swap_slots[slot].zswap = ZSWAP_NONE;
+	bitmap_mark (swap_writing, slot);
+	lock_release (&swap_lock);
+
+	disk = swap_slot_locate (slot, &sector);
+	disk_write_multi (disk, sector, buf, SECTORS_PER_PAGE);
+	palloc_free_page (buf);
+
+	lock_acquire (&swap_lock);
+	bitmap_reset (swap_writing, slot);
+	if (swap_slots[slot].refs == 0)
+		swap_slot_free (slot);
+	cond_broadcast (&swap_cond, &swap_lock);
+	lock_release (&swap_lock);
+}
+
+/* Called by vm_unmap_frame() with frame_lock held, for each page
+   that shared the frame being swapped out.  The first call picks
+   the slot: the one the frame was loaded from if nothing wrote to
+   it since, otherwise a new one. */
+static void
+anon_unmapped (struct page *page, void *w_) {
+	struct anon_swap_write *w = w_;
+	struct frame *frame = page->frame;
+
+	lock_acquire (&swap_lock);
+	if (w->slot == BITMAP_ERROR) {
+		if (!frame->dirty && frame->swap_slot >= 0)
+			w->slot = frame->swap_slot;
+		else {
+			w->slot = swap_slot_alloc ();
+			if (w->slot == BITMAP_ERROR)
+				PANIC ("vm: cannot evict page, swap is full");
+			swap_slots[w->slot].pml4 = page->pml4;
+			swap_slots[w->slot].va = page->va;
+			w->write = true;
+		}
+	}
+	// anon_page구조체에 page위치 저장
+	page->anon.swap_location = w->slot;
+	swap_slots[w->slot].refs++;
+	lock_release (&swap_lock);
+}
+
+/* Swap out the page by writing contents to the swap disk.  Every
+   page that shares PAGE's frame after a fork goes to the same
+   slot.  A frame that still matches the slot it was swapped in
+   from is not written again. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	struct anon_swap_write w;
+
+	anon_swap_out_start (page, &w);
+	anon_swap_out_finish (&w);
+	return true;
+}
+
+/* Unmaps anonymous PAGE's frame, which the caller has pinned to
+   evict it, and stores its contents, if that is needed: in zswap
+   if they compress, otherwise by queueing a disk write without
+   waiting for it.  Pages evicted in a row get consecutive slots,
+   so the writes of a batch started together merge in the disk
+   queue.  Finish with anon_swap_out_finish(). */
+void
+anon_swap_out_start (struct page *page, struct anon_swap_write *w) {
 	//-------project3-swap in out start----------------
-	// bitmap값이 0인 page를 찾는다.
-	int bitmap_idx = bitmap_scan(swap_table, 0, 1, false);	// bitmap_idx = slot_no
-	if (bitmap_idx == BITMAP_ERROR) {	
-		return false;	// 찾지 못한 경우 
+	w->frame = page->frame;
+	w->slot = BITMAP_ERROR;
+	w->write = false;
+	w->disk = false;
+	// 모든 pml4 에서 삭제한 뒤에 쓴다.  이후 PAGE 는 해제됐을 수 있음
+	vm_unmap_frame(w->frame, anon_unmapped, w);
+	if (w->write) {
+		int handle = zswap_store(w->frame->kva, w->slot);
+
+		// 가득 찼으면 오래된 것 하나를 disk 로 내리고 한 번 더
+		if (handle == ZSWAP_FULL) {
+			swap_writeback();
+			handle = zswap_store(w->frame->kva, w->slot);
+		}
+		if (handle != ZSWAP_NONE && handle != ZSWAP_FULL) {
+			lock_acquire(&swap_lock);
+			swap_slots[w->slot].zswap = handle;
+			lock_release(&swap_lock);
+			return;
+		}
+		if (swap_disk_cnt == 0)
+			PANIC ("vm: cannot evict page, zswap cannot hold it and there is no swap disk");
 	}
-	
-	// disk에 변경사항 write해줌, 1page = 8sector = 8slot
-	for (int i=0; i < SECTORS_PER_PAGE; ++i) {
-		// DISK_SECTOR_SIZE = 512 = 1섹터의 크기가 512bytes이기 때문
-		disk_write(swap_disk, bitmap_idx*SECTORS_PER_PAGE + i, page->va + DISK_SECTOR_SIZE*i);  //질문 잘 기억 안남.
+	if (w->write) {
+		// disk에 변경사항 write해줌, 1page = 8sector 를 명령 하나로
+		disk_sector_t sector;
+		struct disk *disk = swap_slot_locate(w->slot, &sector);
+		disk_request_init(&w->req, disk, sector, w->frame->kva,
+				SECTORS_PER_PAGE, true);
+		disk_submit(&w->req);
+		w->disk = true;
 	}
+}
 
-	//bitmap_set(swap_table, bitmap_idx, true);	// bitmap을 다시 true로 세팅
-	bitmap_flip(swap_table, bitmap_idx);
-	
-	pml4_clear_page(thread_current()->pml4, page->va);	// pml4에서 삭제
+/* Waits for the write started by anon_swap_out_start(), after
+   which the frame may be reused. */
+void
+anon_swap_out_finish (struct anon_swap_write *w) {
+	struct frame *frame = w->frame;
 
-	// anon_page구조체에 page위치 저장
-	anon_page->swap_location = bitmap_idx;
-	return true;
+	if (w->disk)
+		disk_wait(&w->req);
+
+	// frame 이 쥐던 slot 은 이제 page 들이 가리키거나 낡았음
+	if (frame->swap_slot >= 0) {
+		swap_slot_put(frame->swap_slot);
+		frame->swap_slot = -1;
+	}
+	if (w->write) {
+		lock_acquire(&swap_lock);
+		bitmap_reset(swap_writing, w->slot);
+		if (swap_slots[w->slot].refs == 0)	// 쓰는 사이 모두 해제됨
+			swap_slot_free(w->slot);
+		cond_broadcast(&swap_cond, &swap_lock);
+		lock_release(&swap_lock);
+	}
 	//-------project3-swap in out end----------------
 }
 
@@ -109,4 +504,8 @@ anon_swap_out (struct page *page) {
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	// frame 이 있으면 (다른 page 와 공유하지 않을 때) 돌려주고, 없으면 swap slot 을
+	if (!vm_release_frame(page) && anon_page->swap_location >= 0)
+		swap_slot_put(anon_page->swap_location);
 }
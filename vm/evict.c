@@ -0,0 +1,280 @@
+/* evict.c: Page replacement policies for the frame table.
+ *
+ * "clock" is the plain second-chance clock.  "clock-pro" follows
+ * CLOCK-Pro (Jiang, Chen and Zhang, USENIX ATC 2005): a frame is
+ * hot or cold, and only cold frames are evicted.  A newly loaded
+ * page is cold and starts a test period; if it is used again
+ * during the test period it becomes hot.  Pages evicted during
+ * their test period are remembered while not resident, and a
+ * fault on one of them also makes it hot.  The number of cold
+ * frames adapts: a reuse within a test period grows it, a test
+ * period that ends unused shrinks it.  A single sequential pass
+ * over a large area therefore only cycles through the cold frames
+ * and leaves the hot ones alone.
+ *
+ * Both prefer clean frames: on the first lap the hand passes over
+ * frames whose eviction would need a write (vm_frame_clean()). */
+
+#include "vm/evict.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "vm/vm.h"
+
+const char *evict_policy_name;
+static const struct evict_policy *policy;
+
+static struct frame *clock_victim (void);
+
+static void clockpro_init (void);
+static struct frame *clockpro_victim (void);
+static void clockpro_claimed (struct frame *, struct page *);
+static void clockpro_evicted (struct frame *, struct page *);
+static void clockpro_released (struct frame *);
+static void clockpro_forget (struct page *);
+static void clockpro_run_hot_hand (bool force);
+static void clockpro_shrink_cold (void);
+
+static const struct evict_policy policies[] = {
+	{
+		.name = "clock-pro",
+		.init = clockpro_init,
+		.victim = clockpro_victim,
+		.claimed = clockpro_claimed,
+		.evicted = clockpro_evicted,
+		.released = clockpro_released,
+		.forget = clockpro_forget,
+	},
+	{
+		.name = "clock",
+		.victim = clock_victim,
+	},
+};
+
+/* Selects the policy named by -evict.  Called by vm_init() after
+   the frame table is set up. */
+void
+evict_init (void) {
+	const char *name = evict_policy_name != NULL ? evict_policy_name
+		: policies[0].name;
+	size_t i;
+
+	for (i = 0; i < sizeof policies / sizeof *policies; i++)
+		if (!strcmp (policies[i].name, name))
+			policy = &policies[i];
+	if (policy == NULL)
+		PANIC ("unknown page replacement policy `%s'", name);
+	if (policy->init != NULL)
+		policy->init ();
+}
+
+struct frame *
+evict_victim (void) {
+	return policy->victim ();
+}
+
+void
+evict_claimed (struct frame *frame, struct page *page) {
+	if (policy->claimed != NULL)
+		policy->claimed (frame, page);
+}
+
+void
+evict_evicted (struct frame *frame, struct page *page) {
+	if (policy->evicted != NULL)
+		policy->evicted (frame, page);
+}
+
+void
+evict_released (struct frame *frame) {
+	if (policy->released != NULL)
+		policy->released (frame);
+}
+
+void
+evict_forget (struct page *page) {
+	if (policy->forget != NULL)
+		policy->forget (page);
+}
+
+/* Returns true if FRAME may be evicted now. */
+static bool
+evictable (struct frame *frame) {
+	return frame->used && !frame->pinned;
+}
+
+/* clock */
+
+static size_t clock_hand;	// 다음에 볼 frame 의 index
+
+/* accessed 인 frame 은 bit 만 지우고 지나감 */
+static struct frame *
+clock_victim (void) {
+	size_t cnt = vm_frame_cnt ();
+	size_t i;
+
+	// 깨끗한 frame 만 보는 첫 바퀴 뒤 두 바퀴면 accessed 가 모두 지워지므로
+	// pinned 가 아닌 frame 을 반드시 만남
+	for (i = 0; i < 3 * cnt; i++) {
+		struct frame *frame = vm_frame_at (clock_hand);
+
+		clock_hand = (clock_hand + 1) % cnt;
+		if (!evictable (frame) || (i < cnt && !vm_frame_clean (frame)))
+			continue;
+		if (!vm_frame_accessed (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+/* clock-pro */
+
+static size_t cold_hand, hot_hand;
+static size_t hot_cnt;        /* hot 인 frame 수. */
+static size_t cold_target;    /* cold 로 둘 frame 수 (1 .. cnt - 1). */
+static struct list test_pages; /* test 기간 중 쫓겨난 page, 오래된 순. */
+static size_t test_cnt;       /* test_pages 의 원소 수. */
+
+static void
+clockpro_init (void) {
+	size_t cnt = vm_frame_cnt ();
+
+	ASSERT (cnt >= 2);
+	cold_target = cnt / 4 > 0 ? cnt / 4 : 1;
+	list_init (&test_pages);
+}
+
+/* The cold hand: evicts the first cold frame not used since the
+   hand last passed it.  A used cold frame in its test period is
+   promoted to hot; one that is not starts a test period. */
+static struct frame *
+clockpro_victim (void) {
+	size_t cnt = vm_frame_cnt ();
+	size_t i;
+
+	// 세 바퀴: 그 사이 hot hand 가 cold frame 을 만들어 줌
+	for (i = 0; i < 3 * cnt; i++) {
+		struct frame *frame = vm_frame_at (cold_hand);
+
+		cold_hand = (cold_hand + 1) % cnt;
+		if (!evictable (frame))
+			continue;
+		if (frame->hot) {
+			// 한 바퀴를 돌아도 쫓아낼 cold frame 이 없으면 hot hand 가 식힌다
+			if (i >= cnt)
+				clockpro_run_hot_hand (true);
+			continue;
+		}
+		if (i < cnt && !vm_frame_clean (frame))
+			continue;
+		if (!vm_frame_accessed (frame))
+			return frame;
+		if (frame->test) {
+			// test 기간 중 다시 쓰임: cold 가 부족했다는 뜻
+			frame->hot = true;
+			frame->test = false;
+			hot_cnt++;
+			if (cold_target < cnt - 1)
+				cold_target++;
+			clockpro_run_hot_hand (false);
+		} else
+			frame->test = true;
+	}
+	return NULL;
+}
+
+/* The hot hand: while there are more hot frames than the target,
+   demotes hot frames not used since the hand last passed them.  If
+   FORCE, demotes at least one.  Cold frames it passes end their
+   test period. */
+static void
+clockpro_run_hot_hand (bool force) {
+	size_t cnt = vm_frame_cnt ();
+	size_t i;
+
+	for (i = 0; i < 2 * cnt && (force || hot_cnt > cnt - cold_target); i++) {
+		struct frame *frame = vm_frame_at (hot_hand);
+
+		hot_hand = (hot_hand + 1) % cnt;
+		if (!evictable (frame))
+			continue;
+		if (!frame->hot) {
+			if (frame->test) {
+				frame->test = false;
+				clockpro_shrink_cold ();
+			}
+			continue;
+		}
+		if (!vm_frame_accessed (frame)) {
+			frame->hot = false;
+			hot_cnt--;
+			force = false;
+		}
+	}
+}
+
+/* A test period ended without the page being used again. */
+static void
+clockpro_shrink_cold (void) {
+	if (cold_target > 1)
+		cold_target--;
+}
+
+/* 새로 채운 page 는 cold 로 test 기간을 시작한다.  test 기간 중
+   쫓겨났던 page 가 돌아오면 바로 hot */
+static void
+clockpro_claimed (struct frame *frame, struct page *page) {
+	size_t cnt = vm_frame_cnt ();
+
+	ASSERT (!frame->hot);
+	frame->test = true;
+	if (page == NULL || !page->in_test)
+		return;
+
+	list_remove (&page->test_elem);
+	page->in_test = false;
+	test_cnt--;
+	frame->hot = true;
+	frame->test = false;
+	hot_cnt++;
+	if (cold_target < cnt - 1)
+		cold_target++;
+	clockpro_run_hot_hand (false);
+}
+
+/* test 기간 중인 frame 의 page 는 쫓겨난 뒤에도 기억한다.  기억하는
+   page 는 frame 수를 넘지 않도록 오래된 것부터 잊음 */
+static void
+clockpro_evicted (struct frame *frame, struct page *page) {
+	ASSERT (!frame->hot);
+	if (!frame->test)
+		return;
+
+	page->in_test = true;
+	list_push_back (&test_pages, &page->test_elem);
+	if (++test_cnt > vm_frame_cnt ()) {
+		struct page *oldest = list_entry (list_pop_front (&test_pages),
+				struct page, test_elem);
+
+		oldest->in_test = false;
+		test_cnt--;
+		clockpro_shrink_cold ();
+	}
+}
+
+static void
+clockpro_released (struct frame *frame) {
+	if (frame->hot)
+		hot_cnt--;
+	frame->hot = false;
+	frame->test = false;
+}
+
+static void
+clockpro_forget (struct page *page) {
+	if (page->in_test) {
+		list_remove (&page->test_elem);
+		page->in_test = false;
+		test_cnt--;
+	}
+}
@@ -35,9 +35,19 @@ void vm_file_init(void)
 bool file_backed_initializer(struct page *page, enum vm_type type, void *kva)
 {
 	
+	/* uninit_page 와 file_page 는 union 을 공유하므로, 덮어쓰기 전에 aux 를 꺼낸다 */
+	struct container *container = (struct container *)page->uninit.aux;
+
 	/* Set up the handler */
 	page->operations = &file_ops;
 	struct file_page *file_page = &page->file;
+	file_page->file = container->file;
+	file_page->length = container->page_read_bytes;
+	file_page->offset = container->offset;
+#ifdef EFILESYS
+	file_page->cache = NULL;
+	file_page->pml4 = NULL;
+#endif
 
 	return true;
 	
@@ -52,10 +62,9 @@ file_backed_swap_in(struct page *page, void *kva)
 		return NULL;
 	}
 
-	struct container *container = (struct container *)page->uninit.aux;	// page에서 container에서 가져옴
-	struct file *file = container->file;
-	off_t offsetof =container->offset;
-	size_t page_read_bytes = container->page_read_bytes;
+	struct file *file = file_page->file;
+	off_t offsetof = file_page->offset;
+	size_t page_read_bytes = file_page->length;
 	size_t page_zero_bytes = PGSIZE - page_read_bytes;
 	
 	// file에서 frame으로(kva통해서) read하기
@@ -76,16 +85,14 @@ file_backed_swap_out(struct page *page)
 	if (page==NULL) {	// page가 NULL이면 종료
 		return NULL;
 	}
-	// 12/10 수정: (struct container *) 추가;
-	struct container *container = (struct container *) page->uninit.aux;	// page에서 container에서 가져옴
-
+	// 다른 프로세스의 page 일 수 있으므로 page 를 mapping 한 pml4 와 frame 의 kva 를 씀
 	// dirtybit가 1인 경우 수정사항을 file에 업데이트(swapout)해준다. 
-	if(pml4_is_dirty(thread_current()->pml4, page->va)) {
-		file_write_at(container->file,page->va, container->page_read_bytes, container->offset);
-		pml4_set_dirty(thread_current()->pml4, page->va, 0);
+	if(pml4_is_dirty(page->pml4, page->va)) {
+		file_write_at(file_page->file, page->frame->kva, file_page->length, file_page->offset);
+		pml4_set_dirty(page->pml4, page->va, 0);
 	}
 	// page-frame 연결 해제
-	pml4_clear_page(thread_current()->pml4, page->va);
+	pml4_clear_page(page->pml4, page->va);
 	return true;
 }
 
@@ -97,8 +104,28 @@ static void
 file_backed_destroy(struct page *page)
 {
 	struct file_page *file_page UNUSED = &page->file;
+#ifdef EFILESYS
+	page_cache_unmap(page);	// 쓴 내용은 page cache 에 남았다가 파일로 내려감
+#else
+	vm_release_frame(page);
+#endif
 }
 
+#ifdef EFILESYS
+/* Maps the page cache frame that holds PAGE's part of the file at
+ * PAGE->va.  On the first fault the page is still uninit; it is
+ * turned into a file page here without running lazy_load_segment(),
+ * since the page cache reads the file itself. */
+bool
+file_backed_map(struct page *page)
+{
+	if (VM_TYPE(page->operations->type) == VM_UNINIT)
+		if (!page->uninit.page_initializer(page, page->uninit.type, NULL))
+			return false;
+	return page_cache_map(page, file_get_inode(page->file.file), page->file.offset);
+}
+#endif
+
 /* Do the mmap */
 /* 가상주소 addr부터 file의 크기만큼 다수의 page를 생성한 뒤, 
    각 page에 file의 정보를 저장 (file의 offset부터 lenght 크기만큼)
@@ -173,6 +200,17 @@ void do_munmap(void *addr)
 	if (thread_current()->mmap_addr != addr) {	// 추후 list에서 찾는 것으로 바꿔야 함
 		return NULL;
 	}
+#ifdef EFILESYS
+	// 매핑한 page 들을 spt 에서 없앤다. destroy 가 page cache 와의 연결을 끊음
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct page *page;
+	while ((page = spt_find_page(spt, addr)) != NULL && page_get_type(page) == VM_FILE) {
+		spt_delete_page(spt, page);
+		vm_dealloc_page(page);
+		addr += PGSIZE;
+	}
+	return;
+#endif
 	// while문 돌면서 file을 page단위로 page-frame 연결을 해제함
 	while(1) {
 		// addr로 page 찾기
@@ -180,12 +218,12 @@ void do_munmap(void *addr)
 		if (page==NULL) {	// page가 NULL이면 종료
 			return NULL;
 		}
-		struct container *container = (struct container *)page->uninit.aux;	// page에서 container 가져옴
+		struct file_page *file_page = &page->file;
 		
 		// dirty bit가 1이라면(수정했다면) if문 진입 + writable이라면
 		if (pml4_is_dirty(thread_current()->pml4, page->va) && (page->writable == 1)) {	
 			// addr(메모리)에 적힌 내용을 file에 덮어쓰기
-			file_write_at(container->file, addr, container->page_read_bytes, container->offset);	
+			file_write_at(file_page->file, addr, file_page->length, file_page->offset);	
 			// dirty bit를 다시 0으로 변경
 			pml4_set_dirty(thread_current()->pml4, page->va, 0);
 			
@@ -0,0 +1,145 @@
+/* ksm.c: Kernel same-page merging.
+ *
+ * ksmd walks the frame table a few frames at a time and hashes
+ * each anonymous frame.  A frame whose hash changed since the
+ * previous walk is still being written and is left alone; one
+ * whose hash held is looked up in a table of the stable frames
+ * seen so far in this walk.  Two frames with the same hash are
+ * compared byte by byte and, if equal, merged by
+ * vm_merge_frames(): every page of one is mapped read-only to the
+ * other, as after fork, and the first write to any of them copies
+ * the frame again in vm_handle_wp().  The table is emptied at the
+ * end of each walk, so it never refers to frames that changed long
+ * ago.
+ *
+ * Only ksmd uses the table and the per-frame entries, so they
+ * need no lock; vm_merge_frames() takes the frame table lock. */
+
+#include "vm/ksm.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/evict.h"
+#include "vm/vm.h"
+
+/* What ksmd remembers about one frame of the frame table. */
+struct ksm_entry {
+	struct hash_elem elem;      /* Element in `stable', keyed by SUM. */
+	uint64_t sum;               /* Hash of the contents at the last look. */
+	size_t idx;                 /* Index in the frame table. */
+};
+
+bool ksm_enabled;
+
+static struct ksm_entry *entries;
+static struct hash stable;      /* Frames whose hash held, this walk. */
+static size_t cursor;           /* Next frame to look at. */
+
+/* Counters for ksm_print_stats(). */
+static long long scanned_cnt, merged_cnt;
+
+static void ksm_daemon (void *aux);
+static void ksm_scan (size_t idx);
+static uint64_t ksm_hash (const struct hash_elem *, void *aux);
+static bool ksm_less (const struct hash_elem *, const struct hash_elem *,
+		void *aux);
+
+/* Starts ksmd if -ksm was given.  Called by vm_init() after the
+   frame table is set up. */
+void
+ksm_init (void) {
+	size_t cnt = vm_frame_cnt ();
+	size_t i;
+
+	if (!ksm_enabled)
+		return;
+	entries = calloc (cnt, sizeof *entries);
+	if (entries == NULL || !hash_init (&stable, ksm_hash, ksm_less, NULL))
+		PANIC ("ksm: out of memory");
+	for (i = 0; i < cnt; i++)
+		entries[i].idx = i;
+	thread_create ("ksmd", PRI_DEFAULT, ksm_daemon, NULL);
+}
+
+/* Returns the number of frames freed by merging so far. */
+size_t
+ksm_merged_cnt (void) {
+	return merged_cnt;
+}
+
+/* Prints ksm statistics. */
+void
+ksm_print_stats (void) {
+	if (ksm_enabled)
+		printf ("ksm: %lld frames scanned, %lld merged\n", scanned_cnt,
+				merged_cnt);
+}
+
+/* Looks at KSM_SCAN_PAGES frames every KSM_SCAN_TICKS ticks. */
+static void
+ksm_daemon (void *aux UNUSED) {
+	size_t cnt = vm_frame_cnt ();
+
+	for (;;) {
+		size_t i;
+
+		timer_sleep (KSM_SCAN_TICKS);
+		for (i = 0; i < KSM_SCAN_PAGES; i++) {
+			ksm_scan (cursor);
+			// 한 바퀴가 끝나면 그동안 바뀌었을 수 있는 frame 들을 잊음
+			if (++cursor == cnt) {
+				cursor = 0;
+				hash_clear (&stable, NULL);
+			}
+		}
+	}
+}
+
+/* Looks at frame IDX and merges it with an equal stable frame
+   seen earlier in this walk, if there is one. */
+static void
+ksm_scan (size_t idx) {
+	struct frame *frame = vm_frame_at (idx);
+	struct ksm_entry *e = &entries[idx];
+	struct ksm_entry *other;
+	struct hash_elem *found;
+	uint64_t sum;
+
+	if (!vm_frame_mergeable (frame))
+		return;
+	scanned_cnt++;
+
+	// lock 없이 읽으므로 도중에 바뀔 수 있지만, 합치기 전에 다시 비교함
+	sum = hash_bytes (frame->kva, PGSIZE);
+	if (sum != e->sum) {
+		e->sum = sum;	// 아직 자주 바뀌는 page
+		return;
+	}
+
+	found = hash_insert (&stable, &e->elem);
+	if (found == NULL)
+		return;
+	other = hash_entry (found, struct ksm_entry, elem);
+	if (vm_merge_frames (vm_frame_at (other->idx), frame))
+		merged_cnt++;
+	else
+		// 먼저 들어온 frame 이 그 사이 바뀌었거나 해제됨
+		hash_replace (&stable, &e->elem);
+}
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_entry, elem)->sum;
+}
+
+static bool
+ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_entry, elem)->sum
+		< hash_entry (b, struct ksm_entry, elem)->sum;
+}
@@ -11,6 +11,8 @@
 #include "vm/vm.h"
 #include "vm/uninit.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include <string.h>
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -59,6 +61,10 @@ uninit_initialize (struct page *page, void *kva) {
 	vm_initializer *init = uninit->init;
 	void *aux = uninit->aux;
 
+	// initializer 가 없는 anon page 는 zero frame 과 같은 0 으로 시작
+	if (init == NULL && VM_TYPE (uninit->type) == VM_ANON)
+		memset (kva, 0, PGSIZE);
+
 	// enum vm_type type = uninit->type;
 
 	/* TODO: You may need to fix this function. */
@@ -78,4 +84,7 @@ uninit_destroy (struct page *page) {
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
 	// uninit->aux = NULL;
+	// 남겨 두면 pml4_destroy 가 zero frame 을 해제해 버림
+	if (vm_zero_mapped (page))
+		pml4_clear_page (page->pml4, page->va);
 }
@@ -1,17 +1,55 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <string.h>
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/evict.h"
+#include "vm/ksm.h"
 #include "lib/kernel/hash.h"
 #include "include/threads/thread.h"
 #include "userprog/process.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
+#include <round.h>
 
 //-------project3-memory_management-start--------------
-struct list frame_table;	// frame_table을 전역으로 선언함
-struct list_elem *clock_start;	// frame_table의 시작 elem
+/* frame table: user pool 의 page 하나당 frame 하나.  kva 가 user_base 에서
+   몇 번째 page 인지가 곧 index 라서 frame 마다 malloc 하지 않고, kva 로
+   frame 을 바로 찾는다 */
+static struct frame *frames;
+static size_t frame_cnt;
+static uint8_t *user_base;	// user pool 의 첫 page
+/* frame 과 eviction policy 의 상태를 보호.  page cache
+   kworkerd 도 frame 을 받고 돌려주므로 필요함.  쥔 채로 잡는 lock 은
+   anon.c 의 swap_lock 뿐이다 */
+static struct lock frame_lock;
+/* frame 이 unpin 되거나 내보내기로 page 들이 떨어져 나갈 때 broadcast */
+static struct condition frame_cond;
+
+/* Free-frame reserve.  When fewer than reserve_low frames are free,
+   the reclaim thread evicts up to RECLAIM_BATCH frames at a time,
+   writing their swap slots together, until reserve_high frames are
+   free.  A fault that still finds no free frame evicts one itself.
+   free_cnt 와 reclaim_running 은 frame_lock 으로 보호 */
+#define RECLAIM_BATCH 16
+static size_t free_cnt;		// 쓰이지 않는 frame 수
+static size_t reserve_low, reserve_high;
+static bool reclaim_running;	// reclaim thread 가 깨어 있음
+static struct semaphore reclaim_sema;
+
+/* 모든 process 가 읽기 전용으로 함께 mapping 하는, 0 으로 채운 kernel
+   page.  아직 쓰지 않은 anon page 를 읽으면 frame 대신 이것을 보여 주고,
+   처음 쓸 때 진짜 frame 을 받는다 */
+static void *zero_kva;
+
+static void frame_table_init(void);
+static struct frame *frame_of(void *kva);
+static struct frame *vm_pin_victim(bool wait);
+static void vm_evict_done(struct frame *victim);
+static void vm_reclaim_wakeup(void);
+static void vm_reclaim_daemon(void *aux);
+static bool vm_map_zero(struct page *page);
 //-------project3-memory_management-end----------------
 
 /* Initializes the virtual memory subsystem by invoking
@@ -20,13 +58,22 @@ void vm_init(void)
 {
 	vm_anon_init();
 	vm_file_init();
-#ifdef EFILESYS /* For project 4 */
-	pagecache_init();
-#endif
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table); // frame_table 리스트를 초기화
+	frame_table_init();
+	evict_init();
+	lock_init(&frame_lock);
+	cond_init(&frame_cond);
+	sema_init(&reclaim_sema, 0);
+#ifdef EFILESYS /* For project 4 */
+	/* kworkerd 와 flushd 가 바로 frame 을 잡을 수 있으므로 frame table 과
+	   frame_lock 을 만든 뒤에, reclaim 이 page cache 를 쫓아내기 전에 */
+	pagecache_init();
+#endif
+	thread_create("reclaim", PRI_DEFAULT, vm_reclaim_daemon, NULL);
+	zero_kva = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	ksm_init();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -49,6 +96,13 @@ page_get_type(struct page *page)
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
 static struct frame *vm_evict_frame(void);
+static struct frame *vm_get_free_frame(void);
+static void frame_attach(struct frame *frame, struct page *page);
+static void frame_detach(struct page *page);
+static void frame_fold_dirty(struct frame *frame, struct page *page);
+static bool frame_is_anon(struct frame *frame);
+static void frame_protect(struct frame *frame);
+static bool vm_share_page(struct page *dst, struct page *src);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -93,6 +147,7 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		// uninit_new에게 인자로 받아온 type에 따라 다른 인자들을 넘겨주어, page 구조체에 넣는다.
 		uninit_new(page, upage, init, type, aux, initializer);
 		page->writable = writable;
+		page->pml4 = thread_current()->pml4;
 		
 		// TODO: Insert the page into the spt.
 		return spt_insert_page(spt, page);	// spt에 page를 넣는다
@@ -170,35 +225,68 @@ void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 }
 
 /* Get the struct frame, that will be evicted. */
+/* 고르는 방법은 -evict 로 정한 policy 에 맡김 (evict.c).  모두 pinned 면 NULL */
 static struct frame *
 vm_get_victim(void)
 {
-	struct frame *victim = NULL;
 	/* TODO: The policy for eviction is up to you. */
+	return evict_victim();
+}
 
-	// 내가만든 clock정책
-	struct thread *curr = thread_current();
-    struct list_elem *e = clock_start;
-    for (clock_start = e; clock_start != list_end(&frame_table); clock_start = list_next(clock_start)) {
-        victim = list_entry(clock_start, struct frame, frame_elem);
-		bool succ = pml4_is_accessed(curr->pml4, victim->page->va);
-		if (succ) {
-            pml4_set_accessed (curr->pml4, victim->page->va, 0);
-		}	
-        else {
-            return victim;
+/* Returns true if any page mapping FRAME was accessed since the
+ * previous call, and clears the accessed bits.  Each page is
+ * checked in the page table of the process that maps it, not the
+ * current one.  frame_lock must be held. */
+bool
+vm_frame_accessed(struct frame *frame)
+{
+	struct list_elem *e;
+	bool accessed = false;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+#ifdef EFILESYS
+	// page cache frame 을 mapping 한 page 들은 page cache 가 관리
+	if (VM_TYPE(frame->page->operations->type) == VM_PAGE_CACHE)
+		return page_cache_test_accessed(frame->page);
+#endif
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+			e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		if (pml4_is_accessed(page->pml4, page->va)) {
+			pml4_set_accessed(page->pml4, page->va, false);
+			accessed = true;
 		}
-    }
+	}
+	return accessed;
+}
 
-    for (clock_start = list_begin(&frame_table); clock_start != e; clock_start = list_next(clock_start)) {
-        victim = list_entry(clock_start, struct frame, frame_elem);
-        if (pml4_is_accessed(curr->pml4, victim->page->va))
-            pml4_set_accessed (curr->pml4, victim->page->va, 0);
-        else
-            return victim;
-    }
+/* Returns true if evicting FRAME needs no write: nothing wrote to
+ * it since it was loaded and, for an anonymous page, swap still
+ * holds the same contents.  frame_lock must be held. */
+bool
+vm_frame_clean(struct frame *frame)
+{
+	struct list_elem *e;
 
-	return victim;
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+#ifdef EFILESYS
+	if (VM_TYPE(frame->page->operations->type) == VM_PAGE_CACHE)
+		return page_cache_test_clean(frame->page);
+#endif
+	if (frame->dirty)
+		return false;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+			e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		if (pml4_is_dirty(page->pml4, page->va))
+			return false;
+	}
+	return VM_TYPE(frame->page->operations->type) != VM_ANON
+		|| frame->swap_slot >= 0;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -206,17 +294,119 @@ vm_get_victim(void)
 static struct frame *
 vm_evict_frame(void)
 {
-	struct frame *victim UNUSED = vm_get_victim();
+	struct frame *victim;
+
+	lock_acquire(&frame_lock);
+	victim = vm_pin_victim(true);
 	/* TODO: swap out the victim and return the evicted frame. */
 	// 비우고자 하는 해당 프레임을 victim이라 하고, 
 	// 이 victim과 연결된 가상 페이지를 swap_out()에 인자로 넣어준다.
-	
-	swap_out(victim->page);
+	struct page *page = victim->page;
+	lock_release(&frame_lock);
+	// anon page 는 swap_out 안에서 공유하던 page 들을 모두 떼어냄.
+	// 그 뒤에는 page 가 해제됐을 수 있으므로 다시 보지 않는다
+	if (!swap_out(page))
+		PANIC("vm: cannot evict page, swap is full");
+	vm_evict_done(victim);
+
+	return victim;
+}
+
+/* Picks a victim and pins it, so that no other thread picks the
+   same frame while its page is written out.  If every frame is
+   pinned, waits for one if WAIT, otherwise returns NULL.
+   frame_lock must be held. */
+static struct frame *
+vm_pin_victim(bool wait)
+{
+	struct frame *victim;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	while ((victim = vm_get_victim()) == NULL) {
+		if (!wait)
+			return NULL;
+		// 모든 frame 이 채우거나 내보내는 중: 잠시 양보한 뒤 다시
+		lock_release(&frame_lock);
+		thread_yield();
+		lock_acquire(&frame_lock);
+	}
+	victim->pinned = true;
+	return victim;
+}
+
+/* Detaches whatever still maps VICTIM after its page was swapped
+   out, leaving it pinned and empty. */
+static void
+vm_evict_done(struct frame *victim)
+{
+	vm_unmap_frame(victim, NULL, NULL);
 
 	victim->page = NULL;
+	victim->dirty = false;
+	ASSERT(victim->swap_slot == -1);
 	// memset(victim->kva, 0, PGSIZE);
+}
 
-	return victim;
+/* Wakes the reclaim thread if the reserve ran low.  frame_lock
+   must be held. */
+static void
+vm_reclaim_wakeup(void)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	if (free_cnt < reserve_low && !reclaim_running) {
+		reclaim_running = true;
+		sema_up(&reclaim_sema);
+	}
+}
+
+/* Refills the free-frame reserve.  Each pass pins a batch of
+   victims and starts the swap writes of the anonymous ones before
+   waiting for any, so the next-fit slots of a batch reach the disk
+   queue together and merge into few requests. */
+static void
+vm_reclaim_daemon(void *aux UNUSED)
+{
+	static struct anon_swap_write writes[RECLAIM_BATCH];
+	struct frame *victims[RECLAIM_BATCH];
+	struct page *pages[RECLAIM_BATCH];
+	bool anon[RECLAIM_BATCH];	// 내보낸 뒤에는 page 를 볼 수 없음
+
+	for (;;) {
+		sema_down(&reclaim_sema);
+		lock_acquire(&frame_lock);
+		while (free_cnt < reserve_high) {
+			size_t cnt = 0, i;
+
+			while (cnt < RECLAIM_BATCH && free_cnt + cnt < reserve_high) {
+				struct frame *victim = vm_pin_victim(false);
+
+				if (victim == NULL)
+					break;
+				victims[cnt] = victim;
+				pages[cnt] = victim->page;
+				anon[cnt++] = VM_TYPE(victim->page->operations->type) == VM_ANON;
+			}
+			// 모두 pinned: 다음 할당 때 다시 깨어난다
+			if (cnt == 0)
+				break;
+			lock_release(&frame_lock);
+
+			for (i = 0; i < cnt; i++)
+				if (anon[i])
+					anon_swap_out_start(pages[i], &writes[i]);
+				else if (!swap_out(pages[i]))
+					PANIC("vm: cannot evict page, swap is full");
+			for (i = 0; i < cnt; i++) {
+				if (anon[i])
+					anon_swap_out_finish(&writes[i]);
+				vm_evict_done(victims[i]);
+				vm_free_frame(victims[i]);
+			}
+			lock_acquire(&frame_lock);
+		}
+		reclaim_running = false;
+		lock_release(&frame_lock);
+	}
 }
 
 //-------project3-memory_management-start--------------
@@ -228,46 +418,409 @@ vm_evict_frame(void)
    그리고 이를 물리 메모리의 frame과 연결
    만약 가용 가능한 페이지가 없다면 victim 페이지를 스왑하여 frame 공간을 디스크로 내린다.
 */
+/* 반환된 frame 은 pinned 상태.  page 를 다 채운 쪽에서 pinned 를 풀어야 함 */
 static struct frame *
 vm_get_frame (void) {
 	// 새로운 frame 만들기
 	//printf("==================vm_get_frame 진입\n");
-	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
-
-	// physical memory의 user pool에서 1page를 할당하고, 이에 해당하는 kva를 반환
-	frame->kva = palloc_get_page(PAL_USER);	// 새로 만든 frame과 새로 할당받은 page를 연결
+	struct frame *frame = vm_get_free_frame();
 
-	if (frame->kva == NULL) // 유저 풀 공간이 하나도 없다면
+	if (frame == NULL) // 유저 풀 공간이 하나도 없다면
 	{
 		frame = vm_evict_frame(); // 새로운 프레임을 할당
 		return frame;
 	}
-	list_push_back(&frame_table, &frame->frame_elem);	// frame table 리스트에 frame elem을 넣음
-	clock_start = &frame->frame_elem;	// evict frame 정책이 clock이라서
+	ASSERT(frame->page == NULL);
+
+	return frame;
+}
+
+/* user pool 에 남은 page 를 받아 그 frame 을 쓰기 시작한다.
+   남은 page 가 없으면 아무것도 쫓아내지 않고 NULL 반환 */
+static struct frame *
+vm_get_free_frame (void) {
+	// physical memory의 user pool에서 1page를 할당하고, 이에 해당하는 kva를 반환
+	void *kva = palloc_get_page(PAL_USER);
+	if (kva == NULL) {
+		lock_acquire(&frame_lock);
+		vm_reclaim_wakeup();
+		lock_release(&frame_lock);
+		return NULL;
+	}
 
+	struct frame *frame = frame_of(kva);
+	lock_acquire(&frame_lock);
+	ASSERT(!frame->used && list_empty(&frame->pages) && !frame->hot);
+	free_cnt--;
+	vm_reclaim_wakeup();
 	frame->page = NULL;	// frame의 page멤버 초기화
-	ASSERT(frame != NULL);
-	ASSERT(frame->page == NULL);
+	frame->refcnt = 0;
+	frame->swap_slot = -1;
+	frame->dirty = false;
+	frame->pinned = true;
+	frame->used = true;
+	lock_release(&frame_lock);
 
 	return frame;
 }
+
+/* Returns FRAME, which no page uses any more, to the user pool. */
+void
+vm_free_frame (struct frame *frame) {
+	// swap 에 남겨 둔 사본은 이제 필요 없음
+	if (frame->swap_slot >= 0) {
+		swap_slot_put(frame->swap_slot);
+		frame->swap_slot = -1;
+	}
+	lock_acquire(&frame_lock);
+	ASSERT(frame->refcnt == 0);
+	evict_released(frame);
+	frame->page = NULL;
+	frame->used = false;
+	frame->pinned = false;
+	free_cnt++;
+	lock_release(&frame_lock);
+	palloc_free_page(frame->kva);
+}
+
+/* user pool 의 page 수만큼 frame 을 만들어 두고 각자의 kva 를 정한다 */
+static void
+frame_table_init (void) {
+	size_t i;
+
+	user_base = palloc_user_pool(&frame_cnt);
+	frames = palloc_get_multiple(PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP(frame_cnt * sizeof *frames, PGSIZE));
+	for (i = 0; i < frame_cnt; i++) {
+		frames[i].kva = user_base + i * PGSIZE;
+		list_init(&frames[i].pages);
+	}
+	free_cnt = frame_cnt;
+	reserve_low = frame_cnt / 64 + 2;
+	if (reserve_low > frame_cnt / 4)
+		reserve_low = frame_cnt / 4;
+	reserve_high = 2 * reserve_low;
+}
+
+/* Returns the number of frames in the frame table. */
+size_t
+vm_frame_cnt (void) {
+	return frame_cnt;
+}
+
+/* Returns frame IDX of the frame table. */
+struct frame *
+vm_frame_at (size_t idx) {
+	ASSERT(idx < frame_cnt);
+	return &frames[idx];
+}
+
+/* Returns the frame of user pool page KVA. */
+static struct frame *
+frame_of (void *kva) {
+	size_t idx = pg_no(kva) - pg_no(user_base);
+
+	ASSERT(pg_ofs(kva) == 0);
+	ASSERT((uint8_t *) kva >= user_base && idx < frame_cnt);
+	return &frames[idx];
+}
+
+/* FRAME 을 다시 eviction 대상으로 만든다 */
+void
+vm_unpin_frame (struct frame *frame) {
+	lock_acquire(&frame_lock);
+	frame->pinned = false;
+	cond_broadcast(&frame_cond, &frame_lock);
+	lock_release(&frame_lock);
+}
+
+/* Links PAGE to FRAME.  frame_lock must be held. */
+static void
+frame_attach (struct frame *frame, struct page *page) {
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	list_push_back(&frame->pages, &page->frame_elem);
+	frame->refcnt++;
+	if (frame->page == NULL)
+		frame->page = page;
+	page->frame = frame;
+}
+
+/* Unlinks PAGE from its frame.  frame->page 는 남은 page 중 하나로
+   바꿔서 clock 이 계속 볼 수 있게 한다.  frame_lock must be held. */
+static void
+frame_detach (struct page *page) {
+	struct frame *frame = page->frame;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	list_remove(&page->frame_elem);
+	frame->refcnt--;
+	if (frame->page == page)
+		frame->page = list_empty(&frame->pages) ? NULL
+			: list_entry(list_front(&frame->pages), struct page, frame_elem);
+	page->frame = NULL;
+}
+
+/* Notes in FRAME whether PAGE wrote to it, before PAGE's page
+   table entry is rewritten and loses the dirty bit.  frame_lock
+   must be held. */
+static void
+frame_fold_dirty (struct frame *frame, struct page *page) {
+	if (pml4_is_dirty(page->pml4, page->va))
+		frame->dirty = true;
+}
+
+/* Returns true if FRAME holds anonymous pages and nobody is
+   loading or evicting it.  frame_lock must be held. */
+static bool
+frame_is_anon (struct frame *frame) {
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	return frame->used && !frame->pinned && frame->page != NULL
+		&& VM_TYPE(frame->page->operations->type) == VM_ANON;
+}
+
+/* Maps every page of FRAME read-only, so that the next write to
+   any of them faults into vm_handle_wp().  frame_lock must be
+   held. */
+static void
+frame_protect (struct frame *frame) {
+	struct list_elem *e;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+			e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		frame_fold_dirty(frame, page);
+		pml4_set_page(page->pml4, page->va, frame->kva, false);
+	}
+}
+
+/* Returns true if FRAME is one ksmd may merge. */
+bool
+vm_frame_mergeable (struct frame *frame) {
+	bool mergeable;
+
+	lock_acquire(&frame_lock);
+	mergeable = frame_is_anon(frame);
+	lock_release(&frame_lock);
+	return mergeable;
+}
+
+/* If DUP and KEEP are anonymous frames holding the same bytes,
+ * maps every page of DUP read-only to KEEP, as fork does, and
+ * frees DUP.  A write to any page of KEEP then copies it again in
+ * vm_handle_wp().  Returns false, leaving both in place, if they
+ * differ or either is busy. */
+bool
+vm_merge_frames (struct frame *keep, struct frame *dup) {
+	lock_acquire(&frame_lock);
+	if (keep == dup || !frame_is_anon(keep) || !frame_is_anon(dup)) {
+		lock_release(&frame_lock);
+		return false;
+	}
+	// 먼저 읽기 전용으로 만들어 비교한 내용이 더는 바뀌지 않게 함
+	frame_protect(keep);
+	frame_protect(dup);
+	if (memcmp(keep->kva, dup->kva, PGSIZE)) {
+		lock_release(&frame_lock);
+		return false;
+	}
+	// KEEP 의 swap slot 은 내용이 같으므로 그대로 유효함
+	while (!list_empty(&dup->pages)) {
+		struct page *page = list_entry(list_front(&dup->pages),
+				struct page, frame_elem);
+
+		frame_detach(page);
+		frame_attach(keep, page);
+		pml4_set_page(page->pml4, page->va, keep->kva, false);
+	}
+	dup->pinned = true;	// 해제할 때까지 victim 으로 고르지 않도록
+	lock_release(&frame_lock);
+
+	vm_free_frame(dup);
+	return true;
+}
+
+/* Unmaps PAGE, which is being destroyed, and frees its frame if
+ * no other page shares it.  If the frame is being evicted, waits
+ * until the evictor has taken PAGE off it.  Returns false if PAGE
+ * had no frame. */
+bool
+vm_release_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire(&frame_lock);
+	while ((frame = page->frame) != NULL && frame->pinned)
+		cond_wait(&frame_cond, &frame_lock);
+	if (frame == NULL) {
+		evict_forget(page);
+		lock_release(&frame_lock);
+		return false;
+	}
+	// PTE 를 먼저 지워야 pml4_destroy() 가 frame 을 한 번 더 해제하지 않음
+	pml4_clear_page(page->pml4, page->va);
+	frame_detach(page);
+	if (frame->refcnt == 0)
+		frame->pinned = true;	// 해제할 때까지 victim 으로 고르지 않도록
+	else
+		frame = NULL;
+	lock_release(&frame_lock);
+
+	if (frame != NULL)
+		vm_free_frame(frame);
+	return true;
+}
+
+/* Unmaps FRAME, which the caller has pinned to evict it, from
+ * every page sharing it and unlinks them.  UNMAPPED, if not
+ * null, is called on each page with frame_lock held, so it can
+ * record where the contents go before the owner can fault the
+ * page back in.  By then every mapping is gone and frame->dirty
+ * tells whether any of them wrote to the frame.  Returns the
+ * number of pages unmapped. */
+size_t
+vm_unmap_frame (struct frame *frame,
+		void (*unmapped) (struct page *, void *aux), void *aux) {
+	struct list_elem *e;
+	size_t cnt = 0;
+
+	lock_acquire(&frame_lock);
+	ASSERT(frame->pinned);
+	// 먼저 모두 지워서 더는 쓰이지 않게 한 뒤 dirty 를 모은다
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+			e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		pml4_clear_page(page->pml4, page->va);
+		if (pml4_is_dirty(page->pml4, page->va))
+			frame->dirty = true;
+	}
+	while (!list_empty(&frame->pages)) {
+		struct page *page = list_entry(list_front(&frame->pages),
+				struct page, frame_elem);
+
+		if (unmapped != NULL)
+			unmapped(page, aux);
+		evict_evicted(frame, page);
+		frame_detach(page);
+		cnt++;
+	}
+	cond_broadcast(&frame_cond, &frame_lock);
+	lock_release(&frame_lock);
+	return cnt;
+}
+
+/* Makes DST, a new page of the current (child) process, share
+ * SRC's frame read-only, and makes SRC read-only too, so the
+ * first write by either side copies the frame in vm_handle_wp().
+ * If SRC is swapped out, DST shares its swap slot instead.
+ * Returns false if out of memory. */
+static bool
+vm_share_page (struct page *dst, struct page *src) {
+	struct frame *frame;
+	bool success = true;
+
+	lock_acquire(&frame_lock);
+	while ((frame = src->frame) != NULL && frame->pinned)
+		cond_wait(&frame_cond, &frame_lock);
+	if (frame == NULL)
+		anon_swap_dup(dst);
+	else if (!pml4_set_page(dst->pml4, dst->va, frame->kva, false))
+		success = false;
+	else {
+		// PTE 를 다시 쓰면 dirty bit 가 지워지므로 frame 에 옮겨 둠
+		frame_fold_dirty(frame, src);
+		pml4_set_page(src->pml4, src->va, frame->kva, false);
+		frame_attach(frame, dst);
+	}
+	lock_release(&frame_lock);
+	return success;
+}
 //-------project3-memory_management-end----------------
 
 /* Growing the stack. */
 static void 
 vm_stack_growth(void *addr UNUSED)
 {	
-	// 페이지 할당받기 
-	if (vm_alloc_page(VM_ANON | VM_MARKER_0, addr, 1)) {    // type, upage, writable
-		vm_claim_page(addr); // va에 해당하는 page를 가져온 뒤, vm_do_claim_page()를 호출하여 물리 frame을 새로 할당받고 이를 page와 연결함. 또한, page table entry에 해당 정보를 매핑함
+	// 페이지 할당받기.  frame 은 fault 처리에서 연결함 (읽기만 하면 zero frame)
+	if (vm_alloc_page(VM_ANON | VM_MARKER_0, addr, 1))    // type, upage, writable
 		thread_current()->stack_bottom -= PGSIZE;
-    }
+}
+
+/* Maps PAGE read-only to the shared zero frame if it is known to
+   hold only zeros: an anonymous page that was never loaded and has
+   no initializer, such as a stack or BSS page.  Returns false,
+   mapping nothing, for any other page. */
+static bool
+vm_map_zero(struct page *page)
+{
+	if (page->operations->type != VM_UNINIT
+			|| VM_TYPE(page->uninit.type) != VM_ANON || page->uninit.init != NULL)
+		return false;
+	return pml4_set_page(page->pml4, page->va, zero_kva, false);
+}
+
+/* Returns true if PAGE is mapped to the shared zero frame.  Only
+   the owning process changes that, so no lock is needed. */
+bool
+vm_zero_mapped(struct page *page)
+{
+	return page->frame == NULL && zero_kva != NULL
+		&& pml4_get_page(page->pml4, page->va) == zero_kva;
 }
 
 /* Handle the fault on write_protected page */
+/* fork 후 공유 중인 anon page 에 쓰려 할 때: 다른 page 도 쓰고 있으면
+   새 frame 에 복사해서 떼어내고, 혼자 남았으면 그대로 쓰기를 허용한다 */
 static bool
-vm_handle_wp(struct page *page UNUSED)
+vm_handle_wp(struct page *page)
 {
+	struct frame *frame, *copy = NULL;
+
+	if (!page->writable)
+		return false;
+	// zero frame 을 읽기만 하던 page 에 처음 쓰기: 이제 frame 을 받음
+	if (vm_zero_mapped(page))
+		return vm_do_claim_page(page);
+	if (VM_TYPE(page->operations->type) != VM_ANON)
+		return false;
+
+	for (;;) {
+		lock_acquire(&frame_lock);
+		while ((frame = page->frame) != NULL && frame->pinned)
+			cond_wait(&frame_cond, &frame_lock);
+		if (frame == NULL || frame->refcnt == 1) {
+			// 그 사이 쫓겨났으면 다시 fault 가 나서 swap in 됨
+			if (frame != NULL) {
+				frame_fold_dirty(frame, page);
+				pml4_set_page(page->pml4, page->va, frame->kva, true);
+			}
+			lock_release(&frame_lock);
+			if (copy != NULL)
+				vm_free_frame(copy);
+			return true;
+		}
+		if (copy != NULL) {
+			memcpy(copy->kva, frame->kva, PGSIZE);
+			frame_detach(page);
+			frame_attach(copy, page);
+			evict_claimed(copy, page);
+			pml4_set_page(page->pml4, page->va, copy->kva, true);
+			copy->pinned = false;
+			lock_release(&frame_lock);
+			return true;
+		}
+		lock_release(&frame_lock);
+
+		// frame 을 구하다 FRAME 자체가 쫓겨날 수 있으므로 처음부터 다시 확인
+		copy = vm_get_frame();
+		if (copy == NULL)
+			return false;
+	}
 }
 
 /* Return true on success */
@@ -285,22 +838,31 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED, bool us
 	if (is_kernel_vaddr(addr) || addr == NULL) {
         return false;
 	}
+	if (!not_present) {
+		// 읽기 전용으로 공유 중인 page 에 쓰기
+		page = write ? spt_find_page(spt, addr) : NULL;
+		return page != NULL && vm_handle_wp(page);
+	}
     if (not_present){
 		// 커널이면 thread구조체의 rsp_stack을, 유저면 interrupt frame의 rsp를 사용함
    	 	void *rsp_stack = is_kernel_vaddr(f->rsp) ? thread_current()->rsp_stack : f->rsp;
 
-        if (!vm_claim_page(addr)) {	// page를 새로 할당받지 못하는 경우 진입
+		page = spt_find_page(spt, addr);
+        if (page == NULL) {	// spt 에 없는 주소
 			/* 유저 스택영역에 접근하는 경우임, 참고: 0x100000 = 2^20 = 1MB 
 			   rsp_stack과 한개의 페이지 크기 8사이의 주소에서 page_fault가 났는지, 주소가 유저스택의
 			   최대 최소 영역 안에 있는지 */
-            if (rsp_stack - 8 <= addr && USER_STACK - 0x100000 <= addr && addr <= USER_STACK) { 
-                vm_stack_growth(pg_round_down(addr));	
-                return true;
-            }
-            return false;
+            if (!(rsp_stack - 8 <= addr && USER_STACK - 0x100000 <= addr && addr <= USER_STACK))
+                return false;
+            vm_stack_growth(pg_round_down(addr));	
+			page = spt_find_page(spt, addr);
+			if (page == NULL)
+				return false;
         }
-        else
-            return true;
+		// 아직 쓰지 않은 anon page 를 읽기만 하면 frame 없이 zero frame 을 보여 줌
+		if (!write && vm_map_zero(page))
+			return true;
+		return vm_do_claim_page(page);
     }
     return false;
 	// --------------------project3 Anonymous Page end----------
@@ -346,12 +908,23 @@ bool vm_claim_page(void *va UNUSED)
 static bool
 vm_do_claim_page(struct page *page)	
 { 
+#ifdef EFILESYS
+	// 파일 매핑은 자기 frame 없이 page cache 의 frame 을 공유함
+	if (page_get_type(page) == VM_FILE)
+		return file_backed_map(page);
+#endif
+	// zero frame 을 읽던 자리에 자기 frame 을 mapping
+	if (vm_zero_mapped(page))
+		pml4_clear_page(page->pml4, page->va);
 	struct frame *frame = vm_get_frame();
 	// frame과 page 연결
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	lock_acquire(&frame_lock);
+	frame_attach(frame, page);
+	evict_claimed(frame, page);
+	lock_release(&frame_lock);
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	bool result = false;
 	// install_page: page와 frame의 연결정보를 pml4에 추가하는 함수
 	// 페이지테이블에 frame과 page의 연결을 추가함(pml4에 해당 페이지 추가)
 	if (install_page(page->va, frame->kva, page->writable))
@@ -360,10 +933,56 @@ vm_do_claim_page(struct page *page)
 		// page fault 나고 swap_in 실행 시 uninit_initializer가 실행됨
 		// uninit_initalizer에서 init에 있던 lazy_load_segment 호출되고, type에 맞는 initializer 호출됨
 		//printf("================swap_in 직전\n");
-		int result = swap_in(page, frame->kva);	
-		return result;
+		result = swap_in(page, frame->kva);	
 	}
-	return false;
+	vm_unpin_frame(frame);
+	return result;
+}
+
+/* Maps PAGE of the current process to a free frame, if there is
+ * one, without evicting anything.  Returns the frame pinned, for
+ * the caller to load PAGE into and unpin, or NULL. */
+struct frame *
+vm_claim_free_frame (struct page *page)
+{
+	struct frame *frame = vm_get_free_frame();
+
+	if (frame == NULL)
+		return NULL;
+	lock_acquire(&frame_lock);
+	frame_attach(frame, page);
+	// 미리 읽는 page 는 쓰일지 모르므로 clock-pro 가 기억하던 것도 cold 로
+	evict_forget(page);
+	evict_claimed(frame, NULL);
+	lock_release(&frame_lock);
+	if (!install_page(page->va, frame->kva, page->writable)) {
+		lock_acquire(&frame_lock);
+		frame_detach(page);
+		lock_release(&frame_lock);
+		vm_free_frame(frame);
+		return NULL;
+	}
+	return frame;
+}
+
+/* Claims a frame for PAGE, which lives only in the kernel (a page
+ * cache page) and is mapped in no user page table, and loads it
+ * with swap_in.  If EVICT is false, only a free frame is used.
+ * On success the frame is left pinned for the caller to publish
+ * PAGE before it can be evicted. */
+bool
+vm_claim_kernel_page (struct page *page, bool evict)
+{
+	struct frame *frame = evict ? vm_get_frame() : vm_get_free_frame();
+
+	if (frame == NULL)
+		return false;
+	lock_acquire(&frame_lock);
+	frame->page = page;
+	page->frame = frame;
+	evict_claimed(frame, NULL);
+	lock_release(&frame_lock);
+	return swap_in(page, frame->kva);
 }
 
 //-------project3-memory_management-end----------------
@@ -398,17 +1017,38 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, struct
 				return false;
 			}
 		}
-		else {	// 부모 type이 uninit이 아닌 경우
-			if(!vm_alloc_page(parent_type, upage, writable)) {	// uninit page를 만든다	
+		else if (parent_type == VM_FILE) {	// 부모 type이 file인 경우, 같은 파일 위치로 다시 매핑
+			struct container *container = (struct container *)malloc(sizeof(struct container));
+			if (container == NULL)
+				return false;
+			container->file = parent_page->file.file;
+			container->offset = parent_page->file.offset;
+			container->page_read_bytes = parent_page->file.length;
+			if(!vm_alloc_page_with_initializer(VM_FILE, upage, writable, lazy_load_segment, container)) {
 				return false;
 			}
-			if(!vm_claim_page(upage)) {	// upage에 해당하는 frame을 할당받는다.
+#ifndef EFILESYS
+			// page cache 가 없으면 부모가 아직 파일에 쓰지 않은 내용까지 복사
+			if(!vm_claim_page(upage)) {
 				return false;
 			}
-
-			// 부모 page의 것을 자식 page에 memcpy한다. 
 			struct page* child_page = spt_find_page(dst, upage);
 			memcpy(child_page->frame->kva, parent_page->frame->kva, PGSIZE);
+#endif
+		}
+		else {	// 부모 type이 anon인 경우: 복사하지 않고 frame(또는 swap slot)을 공유
+			struct page *child_page = (struct page *)malloc(sizeof(struct page));
+			if (child_page == NULL)
+				return false;
+			memcpy(child_page, parent_page, sizeof(struct page));
+			child_page->pml4 = thread_current()->pml4;
+			child_page->frame = NULL;
+			child_page->in_test = false;
+			if (!vm_share_page(child_page, parent_page)) {
+				free(child_page);
+				return false;
+			}
+			spt_insert_page(dst, child_page);
 		}
 	}
 	return true;
@@ -421,6 +1061,7 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */ // -> munmap
 	//----------------------------project3 anonymous page start-----------
+#ifndef EFILESYS
 	struct hash_iterator i;
 	hash_first(&i, &spt->spt_hash);
 	while(hash_next(&i)) {
@@ -429,6 +1070,8 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 			do_munmap(target->va);	// type이 file인 경우 munmap도 해야 함	
 		}
 	}
+#endif
+	// EFILESYS 에서는 file page 의 destroy 가 page cache 와의 mapping 을 끊음
 	hash_destroy(&spt->spt_hash, hash_destructor);	// spt 삭제
 	//----------------------------project3 anonymous page end-----------
 
@@ -0,0 +1,265 @@
+/* zswap.c: Compressed in-memory store in front of the swap disk.
+ *
+ * An evicted anonymous page is first compressed with LZF into an
+ * arena of kernel pool pages; only pages that do not compress, or
+ * that do not fit because the arena is full, are written to the
+ * swap disk.  A page of zeros is recorded without any storage.
+ * Swapping such a page back in is a decompression instead of a
+ * disk read.
+ *
+ * The arena follows zbud: each arena page holds at most two
+ * compressed pages, one at its start and one at its end, so
+ * freeing one never has to move the other, and an arena page goes
+ * back to the kernel pool when both are gone.  A handle names one
+ * of the two: arena page index * 2 + which one.
+ *
+ * Each stored page remembers the swap slot it belongs to.  anon.c
+ * keeps the slot allocated while the page is here, so when the
+ * arena is full it can write the page picked by zswap_victim() to
+ * its slot on disk and make room.  With no swap disk the slots have
+ * nothing behind them, so a page that neither compresses nor fits
+ * cannot be evicted. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <lzf.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Largest compressed page worth keeping.  Anything bigger saves
+   too little to be worth the arena space. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+/* One arena page. */
+struct zpage {
+	uint8_t *kva;               /* Kernel page, or NULL if none. */
+	uint16_t len[2];            /* Bytes at the start and at the end, 0 if free. */
+	size_t slot[2];             /* Swap slot each one belongs to. */
+};
+
+int zswap_pages = -1;
+
+static struct zpage *zpages;
+static size_t zpage_cnt;        /* Entries in zpages: the arena's limit. */
+static size_t zpage_used;       /* Entries with a kernel page. */
+static size_t victim_hand;      /* Where zswap_victim() looks next. */
+
+/* Compression scratch space. */
+static uint8_t *zbuf;
+static uint16_t *htab;
+
+/* Counters for zswap_print_stats(). */
+static long long stored_cnt, zero_cnt, reject_cnt, full_cnt, victim_cnt;
+
+/* Protects everything above.  anon.c 의 swap_lock 을 쥔 채로 잡을 수
+   있고, 쥔 채로 다른 lock 은 잡지 않는다 */
+static struct lock zswap_lock;
+
+static bool is_zero (const void *page);
+static int zbud_alloc (size_t len, size_t slot);
+static uint8_t *zbud_data (int handle);
+
+/* Sets up the arena.  Called by vm_anon_init(). */
+void
+zswap_init (void) {
+	lock_init (&zswap_lock);
+	if (zswap_pages < 0) {
+		size_t user_cnt;
+
+		palloc_user_pool (&user_cnt);
+		zpage_cnt = user_cnt / 8;
+	} else
+		zpage_cnt = zswap_pages;
+	if (zpage_cnt == 0)
+		return;
+
+	zpages = calloc (zpage_cnt, sizeof *zpages);
+	zbuf = palloc_get_page (0);
+	htab = palloc_get_multiple (0,
+			DIV_ROUND_UP (LZF_HTAB_SIZE * sizeof *htab, PGSIZE));
+	if (zpages == NULL || zbuf == NULL || htab == NULL)
+		PANIC ("zswap: out of memory for the arena");
+}
+
+/* Returns the most compressed pages the arena can hold, or 0 if
+   zswap is off. */
+size_t
+zswap_capacity (void) {
+	return 2 * zpage_cnt;
+}
+
+/* Stores a copy of PAGE, which belongs to swap slot SLOT, and
+   returns its handle.  Returns ZSWAP_ZERO for a page of zeros,
+   ZSWAP_NONE if PAGE does not compress well, and ZSWAP_FULL if
+   the arena has no room; the caller then writes PAGE to disk. */
+int
+zswap_store (const void *page, size_t slot) {
+	size_t len;
+	int handle;
+
+	// -zswap=0 이면 zero page 도 따로 다루지 않고 disk 로
+	if (zpage_cnt == 0)
+		return ZSWAP_NONE;
+	if (is_zero (page)) {
+		lock_acquire (&zswap_lock);
+		zero_cnt++;
+		lock_release (&zswap_lock);
+		return ZSWAP_ZERO;
+	}
+
+	lock_acquire (&zswap_lock);
+	len = lzf_compress (page, PGSIZE, zbuf, ZSWAP_MAX_LEN, htab);
+	if (len == 0) {
+		reject_cnt++;
+		handle = ZSWAP_NONE;
+	} else if ((handle = zbud_alloc (len, slot)) == ZSWAP_FULL)
+		full_cnt++;
+	else {
+		memcpy (zbud_data (handle), zbuf, len);
+		stored_cnt++;
+	}
+	lock_release (&zswap_lock);
+	return handle;
+}
+
+/* Decompresses the page stored as HANDLE into PAGE. */
+void
+zswap_load (int handle, void *page) {
+	if (handle == ZSWAP_ZERO) {
+		memset (page, 0, PGSIZE);
+		return;
+	}
+
+	lock_acquire (&zswap_lock);
+	if (lzf_decompress (zbud_data (handle), zpages[handle / 2].len[handle % 2],
+				page, PGSIZE) != PGSIZE)
+		PANIC ("zswap: corrupt page %d", handle);
+	lock_release (&zswap_lock);
+}
+
+/* Frees the page stored as HANDLE. */
+void
+zswap_free (int handle) {
+	struct zpage *z;
+
+	if (handle == ZSWAP_ZERO)
+		return;
+	ASSERT (handle >= 0 && (size_t) handle < 2 * zpage_cnt);
+
+	lock_acquire (&zswap_lock);
+	z = &zpages[handle / 2];
+	ASSERT (z->len[handle % 2] != 0);
+	z->len[handle % 2] = 0;
+	// 둘 다 비면 kernel pool 에 돌려줌
+	if (z->len[0] == 0 && z->len[1] == 0) {
+		palloc_free_page (z->kva);
+		z->kva = NULL;
+		zpage_used--;
+	}
+	lock_release (&zswap_lock);
+}
+
+/* Picks a stored page to write back to disk and stores its swap
+   slot in *SLOT.  Pages are picked round-robin over the arena, so
+   roughly the oldest go first.  Returns false if nothing is
+   stored.  The page stays stored; the caller frees it. */
+bool
+zswap_victim (size_t *slot) {
+	size_t i;
+	bool found = false;
+
+	lock_acquire (&zswap_lock);
+	for (i = 0; i < 2 * zpage_cnt && !found; i++) {
+		struct zpage *z = &zpages[victim_hand / 2];
+		int which = victim_hand % 2;
+
+		victim_hand = (victim_hand + 1) % (2 * zpage_cnt);
+		if (z->kva != NULL && z->len[which] != 0) {
+			*slot = z->slot[which];
+			victim_cnt++;
+			found = true;
+		}
+	}
+	lock_release (&zswap_lock);
+	return found;
+}
+
+/* Prints zswap statistics. */
+void
+zswap_print_stats (void) {
+	printf ("zswap: %lld stored, %lld zero, %lld incompressible, "
+			"%lld arena full, %lld written back, %zu/%zu arena pages\n",
+			stored_cnt, zero_cnt, reject_cnt, full_cnt, victim_cnt,
+			zpage_used, zpage_cnt);
+}
+
+/* Returns true if PAGE holds only zeros. */
+static bool
+is_zero (const void *page) {
+	const uint64_t *p = page;
+	size_t i;
+
+	for (i = 0; i < PGSIZE / sizeof *p; i++)
+		if (p[i] != 0)
+			return false;
+	return true;
+}
+
+/* Finds room for LEN compressed bytes belonging to SLOT and
+   returns its handle, or ZSWAP_FULL.  Prefers the free half of an
+   arena page already in use.  zswap_lock must be held. */
+static int
+zbud_alloc (size_t len, size_t slot) {
+	struct zpage *z = NULL;
+	int which = 0;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&zswap_lock));
+
+	for (i = 0; i < zpage_cnt && z == NULL; i++) {
+		struct zpage *cand = &zpages[i];
+
+		if (cand->kva == NULL)
+			continue;
+		if (cand->len[0] == 0 && cand->len[1] + len <= PGSIZE) {
+			z = cand;
+			which = 0;
+		} else if (cand->len[1] == 0 && cand->len[0] + len <= PGSIZE) {
+			z = cand;
+			which = 1;
+		}
+	}
+	for (i = 0; i < zpage_cnt && z == NULL; i++)
+		if (zpages[i].kva == NULL) {
+			zpages[i].kva = palloc_get_page (0);
+			if (zpages[i].kva == NULL)
+				return ZSWAP_FULL;
+			zpage_used++;
+			z = &zpages[i];
+		}
+	if (z == NULL)
+		return ZSWAP_FULL;
+
+	z->len[which] = len;
+	z->slot[which] = slot;
+	return (z - zpages) * 2 + which;
+}
+
+/* Returns where the data of HANDLE is: the start of its arena
+   page for the first half, the end for the second.  zswap_lock
+   must be held. */
+static uint8_t *
+zbud_data (int handle) {
+	struct zpage *z = &zpages[handle / 2];
+
+	ASSERT (lock_held_by_current_thread (&zswap_lock));
+	ASSERT (z->kva != NULL);
+
+	return handle % 2 == 0 ? z->kva : z->kva + PGSIZE - z->len[1];
+}